@@ -50,6 +50,7 @@ void fat_shell(void) {
             vga_print_color("  touch <name>    - Create empty file\n", 0x0F);
             vga_print_color("  rm <name>       - Remove file/directory\n", 0x0F);
             vga_print_color("  write <f> <txt> - Write text to file\n", 0x0F);
+            vga_print_color("  append <f> <txt>- Append a line to file\n", 0x0F);
             vga_print_color("  exec <file>     - Execute ELF program\n", 0x0F);
             vga_print_color("  info            - Filesystem info\n", 0x0F);
             vga_print_color("  clear           - Clear screen\n", 0x0F);
@@ -93,6 +94,19 @@ void fat_shell(void) {
                 vga_print_color("Usage: write <file> <text>\n", LIGHT_RED);
             }
         }
+        else if (strcmp(cmd, "append") == 0) {
+            char* text = strchr(args, ' ');
+            if (text) {
+                *text = '\0';
+                text++;
+                size_t len = strlen(text);
+                text[len] = '\n';
+                fat_append(args, text, len + 1);
+                text[len] = '\0';
+            } else {
+                vga_print_color("Usage: append <file> <text>\n", LIGHT_RED);
+            }
+        }
         else if (strcmp(cmd, "exec") == 0 || strcmp(cmd, "run") == 0 || strcmp(cmd, "./") == 0) {
             if (args[0]) {
                 elf_exec(args);
@@ -2,15 +2,19 @@
 [bits 32]
 [extern kernel_main]
 
+; Флаг 0x02: попросить у загрузчика сведения о памяти (mem_lower/upper и карту памяти)
 section .multiboot
     align 4
     dd 0x1BADB002
-    dd 0x00
-    dd -(0x1BADB002 + 0x00)
+    dd 0x02
+    dd -(0x1BADB002 + 0x02)
 
 section .text
 global _start
 _start:
+    ; kernel_main(magic, multiboot_info): EAX - магическое число загрузчика, EBX - адрес структуры
+    push ebx
+    push eax
     call kernel_main
 .hang:
     jmp .hang
@@ -1,11 +1,19 @@
 #include "isr.h"
 #include "../pic/pic.h"
+#include "../paging/paging.h"
 #include "../../../sys/panic.h"
 #include "../../../drivers/keyboard/keyboard.h"
+#include "../../../drivers/ata/ata.h"
 
 
 extern void timer_handler(void);
 
+// Обработчики, зарегистрированные драйверами через irq_register_handler
+static struct {
+    irq_callback_t handler;
+    void* ctx;
+} irq_handlers[16][IRQ_MAX_SHARED];
+
 // Текстовые описания первых 32 исключений x86
 const char *exception_messages[] = {
     "Division By Zero",
@@ -37,11 +45,34 @@ const char *exception_messages[] = {
 
 // Сюда прыгает ассемблерный stub
 void isr_handler(registers_t regs) {
+    // Отказ страницы может быть устранен (подкачка по требованию), тогда инструкция повторится
+    if (regs.int_no == 14) {
+        paging_handle_fault(&regs);
+        return;
+    }
     if (regs.int_no < 32) {
         panic("ISR", exception_messages[regs.int_no], "isr_handler");
     }
 }
 
+int irq_register_handler(uint8_t irq, irq_callback_t handler, void* ctx) {
+    // Каскад занят Slave PIC: устройство на этой линии прерываний не получит
+    if (irq >= 16 || irq == IRQ_CASCADE || !handler) return -1;
+
+    for (int i = 0; i < IRQ_MAX_SHARED; i++) {
+        if (irq_handlers[irq][i].handler) continue;
+
+        irq_handlers[irq][i].ctx = ctx;
+        irq_handlers[irq][i].handler = handler;
+
+        // Линии Slave PIC доходят до процессора только через каскад
+        if (irq >= 8) pic_clear_mask(IRQ_CASCADE);
+        pic_clear_mask(irq);
+        return 0;
+    }
+    return -1;
+}
+
 void irq_handler(registers_t regs) {
     uint8_t irq_no = regs.int_no - 32;
 
@@ -52,9 +83,24 @@ void irq_handler(registers_t regs) {
         case IRQ_KEYBOARD:
             keyboard_handler();
             break;
+        case IRQ_ATA1:
+            ata_irq_handler(0);
+            break;
+        case IRQ_ATA2:
+            ata_irq_handler(1);
+            break;
         default:
             break;
     }
 
+    // Общая линия: каждый драйвер сам проверяет, его ли это прерывание
+    if (irq_no < 16) {
+        for (int i = 0; i < IRQ_MAX_SHARED; i++) {
+            if (irq_handlers[irq_no][i].handler) {
+                irq_handlers[irq_no][i].handler(irq_handlers[irq_no][i].ctx);
+            }
+        }
+    }
+
     pic_send_eoi(irq_no);
 }
@@ -16,6 +16,15 @@ typedef struct registers_struct registers_t;
 // Прототип главного обработчика, который вызывается из ассемблера
 void isr_handler(registers_t regs);
 
+// Обработчик IRQ, который регистрирует драйвер (ctx передается обратно как есть)
+typedef void (*irq_callback_t)(void* ctx);
+
+// Сколько драйверов может делить одну линию (PCI INTx бывают общими)
+#define IRQ_MAX_SHARED 4
+
+// Подписать обработчик на линию IRQ и размаскировать ее. 0 - успех, -1 - нет места или линия недоступна
+int irq_register_handler(uint8_t irq, irq_callback_t handler, void* ctx);
+
 // Объявляем внешние ассемблерные заглушки для IDT
 extern void isr0(void);
 extern void isr1(void);
@@ -0,0 +1,290 @@
+#include "paging.h"
+#include "../../../mm/pmm.h"
+#include "../../../sys/panic.h"
+#include "../../../utils/string.h"
+
+#define PAGE_FRAME_MASK     0xFFFFF000
+#define PAGE_LARGE_MASK     0xFFC00000
+#define PDE_INDEX(a)        ((a) >> 22)
+#define PTE_INDEX(a)        (((a) >> 12) & 0x3FF)
+
+#define CR0_WP              0x00010000  // Запись в read-only страницы запрещена и ядру
+#define CR0_PG              0x80000000
+#define CR4_PSE             0x00000010
+#define CPUID_EDX_PSE       0x00000008
+#define EFLAGS_IF           0x00000200
+
+static uint32_t page_dir[1024] __attribute__((aligned(PAGE_SIZE)));
+static paging_stats_t stats;
+
+static struct {
+    uint32_t start;
+    uint32_t end;
+    page_fault_handler_t handler;
+    void* ctx;
+} fault_handlers[PAGING_MAX_FAULT_HANDLERS];
+
+static inline void tlb_flush_page(uint32_t addr) {
+    asm volatile("invlpg (%0)" :: "r"(addr) : "memory");
+}
+
+static inline uint32_t read_cr2(void) {
+    uint32_t value;
+    asm volatile("mov %%cr2, %0" : "=r"(value));
+    return value;
+}
+
+static int cpu_has_pse(void) {
+    uint32_t eax = 1, ebx, ecx, edx;
+    asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    return (edx & CPUID_EDX_PSE) != 0;
+}
+
+// Таблицы лежат в RAM, отображенной тождественно, поэтому физический адрес годится как указатель
+static uint32_t* table_alloc(void) {
+    uint32_t* table = (uint32_t*)pmm_alloc_pages(0, PMM_OWNER_PAGING);
+    if (!table) return 0;
+
+    memset(table, 0, PAGE_SIZE);
+    stats.page_tables++;
+    return table;
+}
+
+// Заменяет запись по 4 МБ таблицей с теми же страницами и правами
+static uint32_t* split_large(uint32_t pdi) {
+    uint32_t pde = page_dir[pdi];
+    uint32_t* table = table_alloc();
+    if (!table) return 0;
+
+    uint32_t base = pde & PAGE_LARGE_MASK;
+    uint32_t flags = pde & (PAGE_PRESENT | PAGE_WRITE | PAGE_USER | PAGE_PWT | PAGE_PCD);
+    for (uint32_t i = 0; i < 1024; i++) {
+        table[i] = (base + i * PAGE_SIZE) | flags;
+    }
+
+    page_dir[pdi] = (uint32_t)table | PAGE_PRESENT | PAGE_WRITE | (pde & PAGE_USER);
+    stats.large_pages--;
+    tlb_flush_page(base);
+    return table;
+}
+
+// Таблица для записи каталога pdi; создается (или дробится крупная страница) при необходимости
+static uint32_t* table_for(uint32_t pdi, uint32_t flags) {
+    uint32_t pde = page_dir[pdi];
+
+    if (!(pde & PAGE_PRESENT)) {
+        uint32_t* table = table_alloc();
+        if (!table) return 0;
+        page_dir[pdi] = (uint32_t)table | PAGE_PRESENT | PAGE_WRITE | (flags & PAGE_USER);
+        return table;
+    }
+    if (pde & PAGE_LARGE) return split_large(pdi);
+
+    // Права каталога и таблицы складываются по "И", поэтому каталог не должен быть строже страницы
+    if (flags & PAGE_USER) page_dir[pdi] |= PAGE_USER;
+    return (uint32_t*)(pde & PAGE_FRAME_MASK);
+}
+
+int paging_map_page(uint32_t virt, uint32_t phys, uint32_t flags) {
+    uint32_t* table = table_for(PDE_INDEX(virt), flags);
+    if (!table) return -1;
+
+    table[PTE_INDEX(virt)] = (phys & PAGE_FRAME_MASK) | (flags & ~PAGE_FRAME_MASK & ~PAGE_LARGE) | PAGE_PRESENT;
+    tlb_flush_page(virt);
+    return 0;
+}
+
+int paging_unmap_page(uint32_t virt) {
+    if (!(page_dir[PDE_INDEX(virt)] & PAGE_PRESENT)) return 0;
+
+    uint32_t* table = table_for(PDE_INDEX(virt), 0);
+    if (!table) return -1;
+
+    table[PTE_INDEX(virt)] = 0;
+    tlb_flush_page(virt);
+    return 0;
+}
+
+int paging_translate(uint32_t virt, uint32_t* phys) {
+    uint32_t pde = page_dir[PDE_INDEX(virt)];
+    if (!(pde & PAGE_PRESENT)) return -1;
+
+    if (pde & PAGE_LARGE) {
+        *phys = (pde & PAGE_LARGE_MASK) | (virt & ~PAGE_LARGE_MASK);
+        return 0;
+    }
+
+    uint32_t pte = ((uint32_t*)(pde & PAGE_FRAME_MASK))[PTE_INDEX(virt)];
+    if (!(pte & PAGE_PRESENT)) return -1;
+
+    *phys = (pte & PAGE_FRAME_MASK) | (virt & ~PAGE_FRAME_MASK);
+    return 0;
+}
+
+int paging_map_mmio(uint32_t phys, uint32_t size) {
+    if (size == 0) return -1;
+
+    uint32_t flags = PAGE_PRESENT | PAGE_WRITE | PAGE_PCD | PAGE_PWT;
+    uint32_t page = phys & PAGE_FRAME_MASK;
+    uint32_t last = (phys + size - 1) & PAGE_FRAME_MASK;
+    if (last < page) last = PAGE_FRAME_MASK;   // Диапазон упирается в 4 ГБ
+
+    for (;;) {
+        uint32_t pdi = PDE_INDEX(page);
+        uint32_t slot_last = (page & PAGE_LARGE_MASK) + PAGE_LARGE_SIZE - PAGE_SIZE;
+
+        // Свободные 4 МБ под регистры устройства обходятся без таблицы
+        if (stats.pse && !(page_dir[pdi] & PAGE_PRESENT)) {
+            page_dir[pdi] = (page & PAGE_LARGE_MASK) | flags | PAGE_LARGE;
+            stats.large_pages++;
+            tlb_flush_page(page);
+        } else {
+            uint32_t stop = last < slot_last ? last : slot_last;
+            for (uint32_t p = page; ; p += PAGE_SIZE) {
+                if (paging_map_page(p, p, flags) < 0) return -1;
+                if (p == stop) break;
+            }
+        }
+
+        if (last <= slot_last) return 0;
+        page = slot_last + PAGE_SIZE;
+    }
+}
+
+int paging_register_fault_handler(uint32_t start, uint32_t end, page_fault_handler_t handler, void* ctx) {
+    if (!handler || end <= start) return -1;
+
+    for (int i = 0; i < PAGING_MAX_FAULT_HANDLERS; i++) {
+        if (fault_handlers[i].handler) continue;
+
+        fault_handlers[i].start = start;
+        fault_handlers[i].end = end;
+        fault_handlers[i].ctx = ctx;
+        fault_handlers[i].handler = handler;
+        return 0;
+    }
+    return -1;
+}
+
+void paging_unregister_fault_handler(page_fault_handler_t handler, void* ctx) {
+    for (int i = 0; i < PAGING_MAX_FAULT_HANDLERS; i++) {
+        if (fault_handlers[i].handler == handler && fault_handlers[i].ctx == ctx) {
+            fault_handlers[i].handler = 0;
+        }
+    }
+}
+
+static char* append_hex(char* p, uint32_t value) {
+    static const char digits[] = "0123456789ABCDEF";
+    *p++ = '0';
+    *p++ = 'x';
+    for (int shift = 28; shift >= 0; shift -= 4) {
+        *p++ = digits[(value >> shift) & 0xF];
+    }
+    *p = 0;
+    return p;
+}
+
+void paging_handle_fault(registers_t* regs) {
+    uint32_t addr = read_cr2();
+    uint32_t err = regs->err_code;
+
+    stats.faults++;
+    stats.last_addr = addr;
+    stats.last_eip = regs->eip;
+    if (err & PF_PROTECTION) stats.protection++;
+    else stats.not_present++;
+    if (err & PF_WRITE) stats.writes++;
+    if (err & PF_FETCH) stats.fetches++;
+
+    // Испорченная запись таблицы - это ошибка ядра, а не повод подгружать страницу
+    if (!(err & PF_RESERVED)) {
+        for (int i = 0; i < PAGING_MAX_FAULT_HANDLERS; i++) {
+            if (!fault_handlers[i].handler) continue;
+            if (addr < fault_handlers[i].start || addr >= fault_handlers[i].end) continue;
+
+            // Обработчик может читать диск, а драйверы ждут IRQ: возвращаем прерывания, если они были включены
+            if (regs->eflags & EFLAGS_IF) asm volatile("sti");
+            int result = fault_handlers[i].handler(addr, err, fault_handlers[i].ctx);
+            asm volatile("cli");
+
+            if (result == 0) {
+                stats.resolved++;
+                return;
+            }
+            break;
+        }
+    }
+
+    // panic() очищает экран, поэтому всё важное должно поместиться в строку причины
+    char reason[64];
+    strcpy(reason, (err & PF_PROTECTION) ? "Protection " : "Not present ");
+    strcat(reason, (err & PF_FETCH) ? "exec " : (err & PF_WRITE) ? "write " : "read ");
+    char* p = append_hex(reason + strlen(reason), addr);
+    strcpy(p, " eip ");
+    append_hex(p + 5, regs->eip);
+
+    panic("Page Fault", reason, "paging_handle_fault");
+}
+
+static int slot_needs_table(uint32_t base, uint32_t ro_start, uint32_t ro_end) {
+    if (!stats.pse || base == 0) return 1;
+    return ro_start < ro_end && ro_start < base + PAGE_LARGE_SIZE && ro_end > base;
+}
+
+void paging_init(uint32_t ram_top) {
+    extern char _text_start, _rodata_end;
+
+    memset(page_dir, 0, sizeof(page_dir));
+    stats.pse = (uint8_t)cpu_has_pse();
+
+    // Только целые страницы: соседние .multiboot (таблица системных вызовов) и .data остаются записываемыми
+    uint32_t ro_start = ((uint32_t)&_text_start + PAGE_SIZE - 1) & PAGE_FRAME_MASK;
+    uint32_t ro_end = (uint32_t)&_rodata_end & PAGE_FRAME_MASK;
+
+    // 0 - память доходит до 4 ГБ (вершина не поместилась в 32 бита)
+    uint32_t slots = (uint32_t)(((uint64_t)ram_top + PAGE_LARGE_SIZE - 1) >> 22);
+    if (slots == 0 || slots > 1024) slots = 1024;
+    stats.mapped_mb = slots * 4;
+
+    for (uint32_t slot = 0; slot < slots; slot++) {
+        uint32_t base = slot << 22;
+
+        if (!slot_needs_table(base, ro_start, ro_end)) {
+            page_dir[slot] = base | PAGE_PRESENT | PAGE_WRITE | PAGE_LARGE;
+            stats.large_pages++;
+            continue;
+        }
+
+        uint32_t* table = table_alloc();
+        if (!table) panic("Paging", "No memory for page tables", "paging_init");
+
+        for (uint32_t i = 0; i < 1024; i++) {
+            uint32_t addr = base + i * PAGE_SIZE;
+            if (addr == 0) continue;    // Разыменование NULL должно падать
+
+            uint32_t flags = PAGE_PRESENT;
+            if (addr < ro_start || addr >= ro_end) flags |= PAGE_WRITE;
+            table[i] = addr | flags;
+        }
+        page_dir[slot] = (uint32_t)table | PAGE_PRESENT | PAGE_WRITE;
+    }
+
+    if (stats.pse) {
+        uint32_t cr4;
+        asm volatile("mov %%cr4, %0" : "=r"(cr4));
+        asm volatile("mov %0, %%cr4" :: "r"(cr4 | CR4_PSE));
+    }
+
+    asm volatile("mov %0, %%cr3" :: "r"(page_dir) : "memory");
+
+    uint32_t cr0;
+    asm volatile("mov %%cr0, %0" : "=r"(cr0));
+    asm volatile("mov %0, %%cr0" :: "r"(cr0 | CR0_PG | CR0_WP) : "memory");
+
+    stats.enabled = 1;
+}
+
+void paging_get_stats(paging_stats_t* out) {
+    *out = stats;
+}
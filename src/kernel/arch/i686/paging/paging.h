@@ -0,0 +1,73 @@
+#ifndef PAGING_H
+#define PAGING_H
+
+#include <stdint.h>
+#include "../idt/isr.h"
+
+// Страничная адресация i686: каталог из 1024 записей, каждая отображает 4 МБ
+// целиком (PSE) или указывает на таблицу из 1024 страниц по 4 КБ
+#define PAGE_SIZE           0x1000
+#define PAGE_LARGE_SIZE     0x400000
+
+// Биты записей каталога и таблиц
+#define PAGE_PRESENT        0x001
+#define PAGE_WRITE          0x002
+#define PAGE_USER           0x004
+#define PAGE_PWT            0x008       // Сквозная запись
+#define PAGE_PCD            0x010       // Без кэширования (MMIO)
+#define PAGE_ACCESSED       0x020
+#define PAGE_DIRTY          0x040
+#define PAGE_LARGE          0x080       // PSE: запись каталога сама отображает 4 МБ
+
+// Код ошибки #PF (кладет процессор)
+#define PF_PROTECTION       0x01        // 0 - страницы нет, 1 - нарушены права доступа
+#define PF_WRITE            0x02
+#define PF_USER             0x04
+#define PF_RESERVED         0x08
+#define PF_FETCH            0x10
+
+// Сколько диапазонов адресов могут обслуживать свои отказы (подкачка по требованию и т.п.)
+#define PAGING_MAX_FAULT_HANDLERS 4
+
+// Обработчик отказа в своем диапазоне: 0 - страница отображена и инструкцию можно повторить, -1 - нет
+typedef int (*page_fault_handler_t)(uint32_t addr, uint32_t err, void* ctx);
+
+typedef struct {
+    uint8_t     enabled;
+    uint8_t     pse;                // Процессор умеет страницы по 4 МБ
+    uint32_t    mapped_mb;          // Размер тождественного отображения RAM
+    uint32_t    large_pages;        // Записей каталога по 4 МБ
+    uint32_t    page_tables;        // Таблиц по 4 КБ
+    uint32_t    faults;
+    uint32_t    resolved;           // Устранены зарегистрированным обработчиком
+    uint32_t    not_present;
+    uint32_t    protection;
+    uint32_t    writes;
+    uint32_t    fetches;
+    uint32_t    last_addr;
+    uint32_t    last_eip;
+} paging_stats_t;
+
+// Строит тождественное отображение [0, ram_top) и включает страничную адресацию.
+// Страница 0 не отображается (ловушка для NULL), код и константы ядра - только для чтения
+void paging_init(uint32_t ram_top);
+
+// Отображает одну страницу 4 КБ (крупная страница при необходимости дробится). 0 - успех, -1 - нет памяти
+int paging_map_page(uint32_t virt, uint32_t phys, uint32_t flags);
+int paging_unmap_page(uint32_t virt);
+
+// Физический адрес для virt; -1 если не отображен
+int paging_translate(uint32_t virt, uint32_t* phys);
+
+// Тождественно отображает регистры устройства без кэширования
+int paging_map_mmio(uint32_t phys, uint32_t size);
+
+int paging_register_fault_handler(uint32_t start, uint32_t end, page_fault_handler_t handler, void* ctx);
+void paging_unregister_fault_handler(page_fault_handler_t handler, void* ctx);
+
+// Вызывается из isr_handler на исключении 14
+void paging_handle_fault(registers_t* regs);
+
+void paging_get_stats(paging_stats_t* stats);
+
+#endif
@@ -31,6 +31,59 @@ uint32_t get_ticks(void) {
     return timer_ticks;
 }
 
+uint32_t get_timer_frequency(void) {
+    return system_frequency;
+}
+
+static uint32_t tsc_per_us = 0;
+
+uint32_t timer_tsc_per_us(void) {
+    if (tsc_per_us || system_frequency == 0) return tsc_per_us;
+
+    // Без прерываний тики не идут, и hlt ниже не проснется
+    uint32_t flags;
+    __asm__ __volatile__("pushfl; popl %0" : "=r"(flags));
+    if (!(flags & 0x200)) return 0;
+
+    // Считаем такты за 5 тиков PIT, начиная с границы тика
+    uint32_t t = get_ticks();
+    while (get_ticks() == t) __asm__ __volatile__("hlt");
+
+    uint32_t start_tick = get_ticks();
+    uint64_t start = timer_read_tsc();
+    while (get_ticks() - start_tick < 5) __asm__ __volatile__("hlt");
+    uint64_t cycles = timer_read_tsc() - start;
+
+    // 5 тиков = 5 000 000 / частота микросекунд; деление 32-битное (без libgcc)
+    uint32_t us = 5000000 / system_frequency;
+    uint32_t high = (uint32_t)(cycles >> 32);
+    uint32_t per = high ? 0xFFFFFFFF : (uint32_t)cycles / us;
+    tsc_per_us = per ? per : 1;
+    return tsc_per_us;
+}
+
+uint32_t timer_tsc_to_us(uint64_t delta) {
+    uint32_t per = timer_tsc_per_us();
+    if (per == 0) return 0;
+
+    // Делим по частям, чтобы обойтись 32-битным делением
+    uint32_t hi = (uint32_t)(delta >> 32);
+    uint32_t lo = (uint32_t)delta;
+    if (hi >= per) return 0xFFFFFFFF;
+
+    uint32_t q = 0;
+    uint32_t r = hi;
+    for (int bit = 31; bit >= 0; bit--) {
+        uint64_t cur = ((uint64_t)r << 1) | ((lo >> bit) & 1);
+        r = (uint32_t)cur;
+        if (cur >= per) {
+            r = (uint32_t)(cur - per);
+            q |= 1u << bit;
+        }
+    }
+    return q;
+}
+
 // Функция задержки в миллисекундах
 void sleep(uint32_t ms) {
     uint32_t ticks_to_wait = (ms * system_frequency) / 1000;
@@ -10,5 +10,19 @@
 void init_timer(uint32_t frequency);
 void sleep(uint32_t ms);
 uint32_t get_ticks(void);
+uint32_t get_timer_frequency(void);
+
+// Счетчик тактов процессора (TSC) для замеров короче одного тика PIT
+static inline uint64_t timer_read_tsc(void) {
+    uint32_t lo, hi;
+    __asm__ volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+// Тактов TSC в микросекунде (калибруется по PIT при первом вызове, 0 если таймер стоит)
+uint32_t timer_tsc_per_us(void);
+
+// Перевод разницы показаний TSC в микросекунды
+uint32_t timer_tsc_to_us(uint64_t delta);
 
 #endif
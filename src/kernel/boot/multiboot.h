@@ -0,0 +1,38 @@
+#ifndef MULTIBOOT_H
+#define MULTIBOOT_H
+
+#include <stdint.h>
+
+// Значение EAX при передаче управления от загрузчика Multiboot
+#define MULTIBOOT_BOOTLOADER_MAGIC  0x2BADB002
+
+// Биты multiboot_info_t.flags
+#define MULTIBOOT_INFO_MEMORY       0x00000001  // mem_lower/mem_upper заполнены
+#define MULTIBOOT_INFO_MEM_MAP      0x00000040  // mmap_addr/mmap_length заполнены
+
+// Тип области в карте памяти: обычная RAM
+#define MULTIBOOT_MEMORY_AVAILABLE  1
+
+// Структура, адрес которой загрузчик передает в EBX
+typedef struct {
+    uint32_t    flags;
+    uint32_t    mem_lower;      // КБ ниже 1 МБ
+    uint32_t    mem_upper;      // КБ выше 1 МБ (до первой дыры)
+    uint32_t    boot_device;
+    uint32_t    cmdline;
+    uint32_t    mods_count;
+    uint32_t    mods_addr;
+    uint32_t    syms[4];
+    uint32_t    mmap_length;
+    uint32_t    mmap_addr;
+} __attribute__((packed)) multiboot_info_t;
+
+// Запись карты памяти; поле size не включает само себя
+typedef struct {
+    uint32_t    size;
+    uint64_t    addr;
+    uint64_t    len;
+    uint32_t    type;
+} __attribute__((packed)) multiboot_mmap_entry_t;
+
+#endif
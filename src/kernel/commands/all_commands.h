@@ -19,8 +19,15 @@ void cmd_aarch();
 void time_cmd();
 void uptime_cmd();
 void meminfo_cmd();
+void cmd_slabinfo(void);
 void cmd_history();
 void cmd_disks();
+void cmd_ramdisk(const char* args);
+void cmd_diskcopy(const char* args);
+void cmd_diskbench(const char* args);
+void cmd_fsbench(void);
+void cmd_bcache(const char* args);
+void cmd_sync(void);
 void cmd_fatwrite();
 void cmd_crash();
 void cmd_mkrootfs(void);
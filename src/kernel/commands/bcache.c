@@ -0,0 +1,57 @@
+#include "all_commands.h"
+#include "../fs/bcache/bcache.h"
+#include "../drivers/vga/vga.h"
+#include "../utils/string.h"
+#include "../drivers/vga/colors.h"
+
+static void print_stat(const char* name, uint32_t value) {
+    char buf[16];
+    vga_print_color(name, 0x0F);
+    itoa(value, buf, 10);
+    vga_print(buf);
+    vga_putc('\n');
+}
+
+void cmd_bcache(const char* args) {
+    if (strncmp(args, "size", 4) == 0) {
+        const char* p = args + 4;
+        while (*p == ' ') p++;
+
+        uint32_t blocks = 0;
+        while (*p >= '0' && *p <= '9') {
+            blocks = blocks * 10 + (*p - '0');
+            p++;
+        }
+
+        if (*p != '\0' || bcache_set_size(blocks) < 0) {
+            vga_print_color("Usage: bcache size <1-1024 blocks>\n", LIGHT_RED);
+        }
+        return;
+    }
+
+    if (strcmp(args, "reset") == 0) {
+        bcache_reset_stats();
+        return;
+    }
+
+    if (args[0]) {
+        vga_print_color("Usage: bcache [size <blocks> | reset]\n", LIGHT_RED);
+        return;
+    }
+
+    bcache_stats_t st;
+    bcache_get_stats(&st);
+
+    vga_print_color("Block cache:\n", YELLOW);
+    print_stat("  Capacity:    ", st.capacity);
+    print_stat("  Used:        ", st.used);
+    print_stat("  Dirty:       ", st.dirty);
+    print_stat("  Hits:        ", st.hits);
+    print_stat("  Misses:      ", st.misses);
+    print_stat("  Disk reads:  ", st.dev_reads);
+    print_stat("  Disk writes: ", st.dev_writes);
+    print_stat("  Writebacks:  ", st.writebacks);
+    print_stat("  Evictions:   ", st.evictions);
+    print_stat("  Readahead:   ", st.prefetched);
+    print_stat("  Flushes:     ", st.flushes);
+}
@@ -0,0 +1,78 @@
+#include "bench.h"
+#include "../arch/i686/timer/timer.h"
+#include "../drivers/vga/vga.h"
+#include "../utils/string.h"
+
+void bench_begin(bench_result_t* r, const char* tool, const char* test) {
+    memset(r, 0, sizeof(bench_result_t));
+    r->tool = tool;
+    r->test = test;
+    r->min_us = 0xFFFFFFFF;
+}
+
+void bench_add(bench_result_t* r, uint32_t us, uint32_t bytes) {
+    r->ops++;
+    r->bytes += bytes;
+    r->total_us += us;
+    if (us < r->min_us) r->min_us = us;
+    if (us > r->max_us) r->max_us = us;
+
+    uint32_t bucket = 0;
+    while (bucket < BENCH_HIST_BUCKETS - 1 && us >= (1u << bucket)) bucket++;
+    r->hist[bucket]++;
+}
+
+/* amount per second without overflowing 32 bits */
+static uint32_t bench_rate(uint32_t amount, uint32_t us) {
+    if (us == 0) return 0;
+    if (amount <= 4294) return (amount * 1000000u) / us;
+    if (us < 1000) return amount;
+
+    uint32_t ms = us / 1000;
+    return (amount / ms) * 1000 + ((amount % ms) * 1000) / ms;
+}
+
+static void bench_field(const char* name, uint32_t value) {
+    char buf[16];
+    vga_print(" ");
+    vga_print(name);
+    vga_print("=");
+    itoa((int)value, buf, 10);
+    vga_print(buf);
+}
+
+void bench_report(const bench_result_t* r) {
+    vga_print(r->tool);
+    vga_print(" test=");
+    vga_print(r->test);
+    bench_field("ops", r->ops);
+    bench_field("bytes", r->bytes);
+    bench_field("us", r->total_us);
+    if (r->bytes) bench_field("kb_per_s", bench_rate(r->bytes / 1024, r->total_us));
+    else bench_field("ops_per_s", bench_rate(r->ops, r->total_us));
+    bench_field("avg_us", r->ops ? r->total_us / r->ops : 0);
+    bench_field("min_us", r->ops ? r->min_us : 0);
+    bench_field("max_us", r->max_us);
+    vga_print("\n");
+
+    for (int i = 0; i < BENCH_HIST_BUCKETS; i++) {
+        if (!r->hist[i]) continue;
+        vga_print(r->tool);
+        vga_print(" test=");
+        vga_print(r->test);
+        vga_print(" hist");
+        /* The last bucket is open-ended: it holds everything from 2^(n-2) up */
+        if (i == BENCH_HIST_BUCKETS - 1) bench_field("ge_us", 1u << (i - 1));
+        else bench_field("lt_us", 1u << i);
+        bench_field("count", r->hist[i]);
+        vga_print("\n");
+    }
+}
+
+uint64_t bench_now(void) {
+    return timer_read_tsc();
+}
+
+uint32_t bench_elapsed_us(uint64_t start) {
+    return timer_tsc_to_us(timer_read_tsc() - start);
+}
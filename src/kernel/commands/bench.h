@@ -0,0 +1,41 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+
+/*
+ * Shared bookkeeping for diskbench and fsbench. Each test prints one
+ * result line and then one line per non-empty latency bucket:
+ *
+ *   diskbench test=seq_read ops=64 bytes=4194304 us=51234 kb_per_s=79945 avg_us=800 min_us=702 max_us=1630
+ *   diskbench test=seq_read hist lt_us=1024 count=60
+ *
+ * Bucket i holds latencies below 2^i microseconds; the last one is
+ * open-ended and printed as ge_us=2^22 (everything at or above it).
+ */
+
+#define BENCH_HIST_BUCKETS  24
+
+typedef struct {
+    const char* tool;
+    const char* test;
+    uint32_t    ops;
+    uint32_t    bytes;
+    uint32_t    total_us;
+    uint32_t    min_us;
+    uint32_t    max_us;
+    uint32_t    hist[BENCH_HIST_BUCKETS];
+} bench_result_t;
+
+void bench_begin(bench_result_t* r, const char* tool, const char* test);
+
+/* Account one operation that moved `bytes` and took `us` microseconds */
+void bench_add(bench_result_t* r, uint32_t us, uint32_t bytes);
+
+void bench_report(const bench_result_t* r);
+
+/* Start/stop a per-operation measurement (TSC based) */
+uint64_t bench_now(void);
+uint32_t bench_elapsed_us(uint64_t start);
+
+#endif
@@ -0,0 +1,122 @@
+#include "all_commands.h"
+#include "bench.h"
+#include "../drivers/block/blockdev.h"
+#include "../fs/bcache/bcache.h"
+#include "../drivers/vga/vga.h"
+#include "../utils/random.h"
+#include "../utils/string.h"
+#include "../drivers/vga/colors.h"
+
+#define DISKBENCH_SEQ_SECTORS   128     /* 64 KB per sequential request */
+#define DISKBENCH_RND_SECTORS   8       /* 4 KB per random request */
+#define DISKBENCH_RND_OPS       256
+#define DISKBENCH_DEFAULT_MB    4
+
+static uint8_t diskbench_buf[DISKBENCH_SEQ_SECTORS * BLOCKDEV_SECTOR_SIZE] __attribute__((aligned(16)));
+
+/*
+ * Writes put back the data just read from the same sectors, so the
+ * benchmark leaves the region unchanged. Only the write itself is timed.
+ */
+static int diskbench_op(uint8_t drive, uint32_t lba, uint16_t count, int write, bench_result_t* r) {
+    if (write && blockdev_read(drive, lba, count, diskbench_buf) < 0) return -1;
+
+    uint64_t start = bench_now();
+    int rc = write ? blockdev_write(drive, lba, count, diskbench_buf)
+                   : blockdev_read(drive, lba, count, diskbench_buf);
+    uint32_t us = bench_elapsed_us(start);
+
+    if (rc < 0) return -1;
+    bench_add(r, us, (uint32_t)count * BLOCKDEV_SECTOR_SIZE);
+    return 0;
+}
+
+static int diskbench_seq(uint8_t drive, uint32_t first, uint32_t sectors, int write) {
+    bench_result_t r;
+    bench_begin(&r, "diskbench", write ? "seq_write" : "seq_read");
+
+    for (uint32_t done = 0; done < sectors; done += DISKBENCH_SEQ_SECTORS) {
+        uint32_t n = sectors - done < DISKBENCH_SEQ_SECTORS ? sectors - done : DISKBENCH_SEQ_SECTORS;
+        if (diskbench_op(drive, first + done, (uint16_t)n, write, &r) < 0) return -1;
+    }
+    if (write && blockdev_flush(drive) < 0) return -1;
+
+    bench_report(&r);
+    return 0;
+}
+
+static int diskbench_random(uint8_t drive, uint32_t first, uint32_t sectors, int write) {
+    bench_result_t r;
+    bench_begin(&r, "diskbench", write ? "rnd_write" : "rnd_read");
+
+    uint32_t slots = sectors / DISKBENCH_RND_SECTORS;
+    for (int i = 0; i < DISKBENCH_RND_OPS; i++) {
+        uint32_t lba = first + (rand() % slots) * DISKBENCH_RND_SECTORS;
+        if (diskbench_op(drive, lba, DISKBENCH_RND_SECTORS, write, &r) < 0) return -1;
+    }
+    if (write && blockdev_flush(drive) < 0) return -1;
+
+    bench_report(&r);
+    return 0;
+}
+
+/* diskbench <drive> [MB] [start_lba] */
+void cmd_diskbench(const char* args) {
+    uint32_t drive = 0, mb = DISKBENCH_DEFAULT_MB, first = 0;
+
+    const char* p = parse_number(args, &drive);
+    if (p) {
+        while (*p == ' ') p++;
+        if (*p != '\0') p = parse_number(p, &mb);
+    }
+    if (p) {
+        while (*p == ' ') p++;
+        if (*p != '\0') p = parse_number(p, &first);
+    }
+
+    if (!p || *p != '\0' || mb == 0) {
+        vga_print_color("Usage: diskbench <drive> [MB] [start_lba]\n", LIGHT_RED);
+        return;
+    }
+
+    blockdev_t* dev = blockdev_get((uint8_t)drive);
+    if (!dev) {
+        vga_print_color("Drive not found\n", LIGHT_RED);
+        return;
+    }
+
+    uint32_t sectors = mb * 2048;
+    if (dev->sectors) {
+        if (first >= dev->sectors) {
+            vga_print_color("Start LBA is past the end of the drive\n", LIGHT_RED);
+            return;
+        }
+        if (sectors > dev->sectors - first) sectors = dev->sectors - first;
+    }
+    if (sectors < DISKBENCH_RND_SECTORS) {
+        vga_print_color("Region too small\n", LIGHT_RED);
+        return;
+    }
+
+    /* Raw device numbers: cached blocks must not be newer than the disk */
+    bcache_sync((uint8_t)drive);
+
+    char buf[16];
+    vga_print("diskbench drive=");
+    itoa((int)drive, buf, 10);
+    vga_print(buf);
+    vga_print(" start_lba=");
+    itoa((int)first, buf, 10);
+    vga_print(buf);
+    vga_print(" sectors=");
+    itoa((int)sectors, buf, 10);
+    vga_print(buf);
+    vga_print("\n");
+
+    if (diskbench_seq((uint8_t)drive, first, sectors, 0) < 0 ||
+        diskbench_seq((uint8_t)drive, first, sectors, 1) < 0 ||
+        diskbench_random((uint8_t)drive, first, sectors, 0) < 0 ||
+        diskbench_random((uint8_t)drive, first, sectors, 1) < 0) {
+        vga_print_color("I/O error\n", LIGHT_RED);
+    }
+}
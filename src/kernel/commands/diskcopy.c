@@ -0,0 +1,125 @@
+#include "all_commands.h"
+#include "../drivers/block/blockdev.h"
+#include "../fs/bcache/bcache.h"
+#include "../fs/fat/fat.h"
+#include "../arch/i686/timer/timer.h"
+#include "../drivers/vga/vga.h"
+#include "../utils/string.h"
+#include "../drivers/vga/colors.h"
+
+/* Two 64 KB buffers: one is written to the target while the next is read into the other */
+#define DISKCOPY_CHUNK_SECTORS  128
+
+static uint8_t diskcopy_buf[2][DISKCOPY_CHUNK_SECTORS * BLOCKDEV_SECTOR_SIZE] __attribute__((aligned(16)));
+
+/* diskcopy <src> <dst> [MB] */
+void cmd_diskcopy(const char* args) {
+    uint32_t src = 0, dst = 0, mb = 0;
+
+    const char* p = parse_number(args, &src);
+    if (p) {
+        while (*p == ' ') p++;
+        p = parse_number(p, &dst);
+    }
+    if (p) {
+        while (*p == ' ') p++;
+        if (*p != '\0') p = parse_number(p, &mb);
+    }
+
+    if (!p || *p != '\0' || src == dst) {
+        vga_print_color("Usage: diskcopy <src> <dst> [MB]\n", LIGHT_RED);
+        return;
+    }
+
+    blockdev_t* from = blockdev_get((uint8_t)src);
+    blockdev_t* to = blockdev_get((uint8_t)dst);
+    if (!from || !to) {
+        vga_print_color("Drive not found\n", LIGHT_RED);
+        return;
+    }
+
+    /* A size of 0 means the device does not know it; the other side decides */
+    uint32_t total = from->sectors;
+    if (to->sectors && (total == 0 || to->sectors < total)) total = to->sectors;
+    if (mb && mb * 2048 < total) total = mb * 2048;
+    if (total == 0) {
+        vga_print_color("Nothing to copy\n", LIGHT_RED);
+        return;
+    }
+
+    /* The FAT driver keeps the table, dentries and handles of its volume in memory */
+    if (fat_get_drive() == (int)dst) {
+        vga_print_color("Target drive is mounted, umount it first\n", LIGHT_RED);
+        return;
+    }
+
+    /* The copy bypasses the cache: source must be current, target's cached blocks go stale */
+    bcache_sync((uint8_t)src);
+    bcache_invalidate((uint8_t)dst);
+
+    uint32_t start = get_ticks();
+    blockdev_request_t rd, wr;
+    int failed = 0;
+
+    rd.lba = 0;
+    rd.count = (uint16_t)(total < DISKCOPY_CHUNK_SECTORS ? total : DISKCOPY_CHUNK_SECTORS);
+    rd.write = 0;
+    rd.buffer = diskcopy_buf[0];
+    if (blockdev_start((uint8_t)src, &rd) < 0 || blockdev_finish((uint8_t)src, &rd) < 0) failed = 1;
+
+    /*
+     * Pipeline: chunk n goes to the target while chunk n + 1 comes from the
+     * source. On separate channels (or devices) both transfers overlap; on
+     * a shared channel the read runs synchronously once the write is done.
+     */
+    uint32_t lba = 0;
+    int cur = 0;
+    while (!failed && lba < total) {
+        wr.lba = lba;
+        wr.count = rd.count;
+        wr.write = 1;
+        wr.buffer = diskcopy_buf[cur];
+
+        uint32_t next = lba + rd.count;
+        int more = next < total;
+
+        int writing = blockdev_start((uint8_t)dst, &wr) == 0;
+        if (!writing) failed = 1;
+        if (more && !failed) {
+            rd.lba = next;
+            rd.count = (uint16_t)(total - next < DISKCOPY_CHUNK_SECTORS ? total - next : DISKCOPY_CHUNK_SECTORS);
+            rd.buffer = diskcopy_buf[cur ^ 1];
+            if (blockdev_start((uint8_t)src, &rd) < 0 || blockdev_finish((uint8_t)src, &rd) < 0) failed = 1;
+        }
+        /* A started write is always collected, even if the read failed */
+        if (writing && blockdev_finish((uint8_t)dst, &wr) < 0) failed = 1;
+
+        lba = next;
+        cur ^= 1;
+    }
+
+    if (!failed && blockdev_flush((uint8_t)dst) < 0) failed = 1;
+    if (failed) {
+        vga_print_color("Copy failed\n", LIGHT_RED);
+        return;
+    }
+
+    uint32_t freq = get_timer_frequency();
+    uint32_t ms = freq ? ((get_ticks() - start) * 1000) / freq : 0;
+
+    char buf[16];
+    vga_print_color("Copied ", 0x0A);
+    itoa(total / 2, buf, 10);
+    vga_print(buf);
+    vga_print(" KB in ");
+    itoa(ms, buf, 10);
+    vga_print(buf);
+    vga_print(" ms");
+    if (ms) {
+        vga_print(" (");
+        itoa((total / 2) * 1000 / ms, buf, 10);
+        vga_print(buf);
+        vga_print(" KB/s)");
+    }
+    vga_putc('\n');
+}
@@ -1,25 +1,39 @@
 #include "all_commands.h"
 #include "../drivers/ata/ata.h"
+#include "../drivers/block/blockdev.h"
 #include "../drivers/vga/vga.h"
 #include "../utils/string.h"
 #include "../drivers/vga/colors.h"
 
 void cmd_disks() {
-    ata_init();
     vga_print_color("Detected drives:\n", YELLOW);
-    for (int i = 0; i < 4; i++) {
-        if (ata_drive_exists(i)) {
-            ata_device_t* dev = ata_get_device(i);
-            char buf[16];
-            itoa(i, buf, 10);
-            vga_print_color("  Drive ", 0x0F);
-            vga_print(buf);
-            vga_print_color(": ", 0x0F);
-            vga_print_color(dev->model, 0x0A);
-            vga_print_color(" (", 0x08);
-            itoa(dev->size / 2048, buf, 10);
-            vga_print(buf);
-            vga_print_color(" MB)\n", 0x08);
+    for (int i = 0; i < BLOCKDEV_MAX; i++) {
+        blockdev_t* dev = blockdev_get(i);
+        if (!dev) continue;
+
+        char buf[16];
+        itoa(i, buf, 10);
+        vga_print_color("  Drive ", 0x0F);
+        vga_print(buf);
+        vga_print_color(" (", 0x0F);
+        vga_print_color(dev->name, 0x0F);
+        vga_print_color("): ", 0x0F);
+        vga_print_color(dev->model, 0x0A);
+        vga_print_color(" (", 0x08);
+        itoa(dev->sectors / 2048, buf, 10);
+        vga_print(buf);
+        vga_print_color(" MB", 0x08);
+
+        if (i < BLOCKDEV_ATA_SLOTS) {
+            ata_device_t* ata = ata_get_device(i);
+            vga_print_color(", ", 0x08);
+            vga_print_color(ata && ata->dma ? "DMA" : "PIO", 0x08);
+            if (ata && ata->lba48) vga_print_color(", LBA48", 0x08);
         }
+
+        vga_print_color(", queue ", 0x08);
+        itoa(dev->queue_depth, buf, 10);
+        vga_print(buf);
+        vga_print_color(")\n", 0x08);
     }
 }
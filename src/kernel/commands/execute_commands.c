@@ -38,6 +38,7 @@ static int execute_cmd_sysinfo(char* args)   { (void)args; cmd_sysinfo(); return
 static int execute_cmd_slowfetch(char* args) { (void)args; cmd_slowfetch(); return 0; }
 static int execute_cmd_uptime(char* args)    { (void)args; uptime_cmd(); return 0; }
 static int execute_cmd_meminfo(char* args)   { (void)args; meminfo_cmd(); return 0; }
+static int execute_cmd_slabinfo(char* args)  { (void)args; cmd_slabinfo(); return 0; }
 static int execute_cmd_time(char* args)      { (void)args; time_cmd(); return 0; }
 static int execute_cmd_aarch(char* args)     { (void)args; cmd_aarch(); return 0; }
 static int execute_cmd_reboot(char* args)    { (void)args; do_reboot(); return 0; }
@@ -118,6 +119,12 @@ static int execute_cmd_nano(char* args) {
 
 // Команды диска и FAT
 static int execute_cmd_disks(char* args)    { (void)args; cmd_disks(); return 0; }
+static int execute_cmd_ramdisk(char* args)  { cmd_ramdisk(args); return 0; }
+static int execute_cmd_diskcopy(char* args) { cmd_diskcopy(args); return 0; }
+static int execute_cmd_diskbench(char* args) { cmd_diskbench(args); return 0; }
+static int execute_cmd_fsbench(char* args)  { (void)args; cmd_fsbench(); return 0; }
+static int execute_cmd_bcache(char* args)   { cmd_bcache(args); return 0; }
+static int execute_cmd_sync(char* args)     { (void)args; cmd_sync(); return 0; }
 static int execute_cmd_umount(char* args)   { (void)args; fat_unmount(); vga_print_color("Unmounted\n", 0x0A); return 0; }
 static int execute_cmd_fatls(char* args)    { fat_ls(args[0] ? args : NULL); return 0; }
 static int execute_cmd_fatpwd(char* args)   { (void)args; fat_pwd(); return 0; }
@@ -166,6 +173,21 @@ static int execute_cmd_fattouch(char* args) {
     return 0;
 }
 
+static int execute_cmd_fatappend(char* args) {
+    char* text = strchr(args, ' ');
+    if (!text) {
+        vga_print_color("Usage: fatappend <file> <text>\n", LIGHT_RED);
+        return 0;
+    }
+    *text++ = '\0';
+
+    size_t len = strlen(text);
+    text[len] = '\n';
+    fat_append(args, text, len + 1);
+    text[len] = '\0';
+    return 0;
+}
+
 // Интернет
 static int execute_cmd_ping(char* args) {
     extern void ping_cmd(char* args); // Прототип, если его нет в all_commands.h
@@ -217,6 +239,7 @@ static const command_t commands[] = {
     {"slowfetch",   execute_cmd_slowfetch},
     {"uptime",      execute_cmd_uptime},
     {"meminfo",     execute_cmd_meminfo},
+    {"slabinfo",    execute_cmd_slabinfo},
     {"time",        execute_cmd_time},
     {"aarch",       execute_cmd_aarch},
     {"reboot",      execute_cmd_reboot},
@@ -251,6 +274,12 @@ static const command_t commands[] = {
 
     // Диски и FAT
     {"disks",       execute_cmd_disks},
+    {"ramdisk",     execute_cmd_ramdisk},
+    {"diskcopy",    execute_cmd_diskcopy},
+    {"diskbench",   execute_cmd_diskbench},
+    {"fsbench",     execute_cmd_fsbench},
+    {"bcache",      execute_cmd_bcache},
+    {"sync",        execute_cmd_sync},
     {"mount",       execute_cmd_mount},
     {"umount",      execute_cmd_umount},
     {"fatls",       execute_cmd_fatls},
@@ -261,6 +290,7 @@ static const command_t commands[] = {
     {"fatrm",       execute_cmd_fatrm},
     {"fattouch",    execute_cmd_fattouch},
     {"fatwrite",    execute_cmd_fatwrite},
+    {"fatappend",   execute_cmd_fatappend},
     {"fatinfo",     execute_cmd_fatinfo},
     {"fat",         execute_cmd_fat},
 
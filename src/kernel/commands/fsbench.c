@@ -0,0 +1,111 @@
+#include "all_commands.h"
+#include "bench.h"
+#include "../fs/fat/fat.h"
+#include "../drivers/vga/vga.h"
+#include "../utils/string.h"
+#include "../drivers/vga/colors.h"
+
+#define FSBENCH_FILE        "/FSBENCH.TMP"
+#define FSBENCH_DIR         "/FSBENCH"
+#define FSBENCH_FILE_SIZE   (64 * 1024)
+#define FSBENCH_DATA_OPS    16
+#define FSBENCH_META_OPS    32
+#define FSBENCH_LOOKUPS     4       /* Lookups per created file */
+
+static uint8_t fsbench_buf[FSBENCH_FILE_SIZE] __attribute__((aligned(16)));
+
+static void fsbench_path(char* out, int i) {
+    char num[12];
+    strcpy(out, FSBENCH_DIR "/F");
+    itoa(i, num, 10);
+    strcat(out, num);
+}
+
+static int fsbench_data(void) {
+    bench_result_t r;
+
+    for (uint32_t i = 0; i < FSBENCH_FILE_SIZE; i++) {
+        fsbench_buf[i] = (uint8_t)(i * 7);
+    }
+
+    bench_begin(&r, "fsbench", "write");
+    for (int i = 0; i < FSBENCH_DATA_OPS; i++) {
+        uint64_t start = bench_now();
+        int rc = fat_write(FSBENCH_FILE, fsbench_buf, FSBENCH_FILE_SIZE);
+        uint32_t us = bench_elapsed_us(start);
+        if (rc < 0) return -1;
+        bench_add(&r, us, FSBENCH_FILE_SIZE);
+    }
+    bench_report(&r);
+
+    bench_begin(&r, "fsbench", "read");
+    for (int i = 0; i < FSBENCH_DATA_OPS; i++) {
+        uint64_t start = bench_now();
+        int rc = fat_read(FSBENCH_FILE, fsbench_buf, FSBENCH_FILE_SIZE);
+        uint32_t us = bench_elapsed_us(start);
+        if (rc != FSBENCH_FILE_SIZE) return -1;
+        bench_add(&r, us, FSBENCH_FILE_SIZE);
+    }
+    bench_report(&r);
+
+    return fat_rm(FSBENCH_FILE);
+}
+
+static int fsbench_meta(void) {
+    bench_result_t r;
+    char path[32];
+
+    if (!fat_is_dir(FSBENCH_DIR) && fat_mkdir(FSBENCH_DIR) < 0) return -1;
+
+    bench_begin(&r, "fsbench", "touch");
+    for (int i = 0; i < FSBENCH_META_OPS; i++) {
+        fsbench_path(path, i);
+        uint64_t start = bench_now();
+        int rc = fat_touch(path);
+        uint32_t us = bench_elapsed_us(start);
+        if (rc < 0) return -1;
+        bench_add(&r, us, 0);
+    }
+    bench_report(&r);
+
+    bench_begin(&r, "fsbench", "lookup");
+    for (int n = 0; n < FSBENCH_LOOKUPS; n++) {
+        for (int i = 0; i < FSBENCH_META_OPS; i++) {
+            fsbench_path(path, i);
+            uint64_t start = bench_now();
+            int found = fat_exists(path);
+            uint32_t us = bench_elapsed_us(start);
+            if (!found) return -1;
+            bench_add(&r, us, 0);
+        }
+    }
+    bench_report(&r);
+
+    bench_begin(&r, "fsbench", "rm");
+    for (int i = 0; i < FSBENCH_META_OPS; i++) {
+        fsbench_path(path, i);
+        uint64_t start = bench_now();
+        int rc = fat_rm(path);
+        uint32_t us = bench_elapsed_us(start);
+        if (rc < 0) return -1;
+        bench_add(&r, us, 0);
+    }
+    bench_report(&r);
+
+    return fat_rm(FSBENCH_DIR);
+}
+
+void cmd_fsbench(void) {
+    if (!fat_is_mounted()) {
+        vga_print_color("No filesystem mounted\n", LIGHT_RED);
+        return;
+    }
+
+    vga_print("fsbench fs=");
+    vga_print(fat_get_type_str());
+    vga_print("\n");
+
+    if (fsbench_data() < 0 || fsbench_meta() < 0) {
+        vga_print_color("fsbench failed\n", LIGHT_RED);
+    }
+}
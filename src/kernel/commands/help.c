@@ -27,7 +27,8 @@ const struct { const char* cmd; const char* desc; } help_table[] = {
     {"sysinfo", "Show system info"},
     {"slowfetch", "Animated banner"},
     {"uptime", "Show uptime"},
-    {"meminfo", "Kernel memory info"},
+    {"meminfo", "Kernel image and physical memory usage"},
+    {"slabinfo", "Kernel heap: slab caches and large blocks"},
     {"time", "Show RTC time"},
     {"reboot", "Reboot machine"},
     {"shutdown", "Shutdown machine"},
@@ -49,8 +50,15 @@ const struct { const char* cmd; const char* desc; } help_table[] = {
     {"fatrm", "Remove FAT file/dir"},
     {"fattouch", "Create FAT file"},
     {"fatwrite", "Write to FAT file"},
+    {"fatappend", "Append a line to FAT file"},
     {"fatinfo", "Show FAT info"},
     {"disks", "Show detected disks"},
+    {"ramdisk", "Create RAM disk (ramdisk <MB> [copy <drive>])"},
+    {"diskcopy", "Copy one drive to another (diskcopy <src> <dst> [MB])"},
+    {"diskbench", "Raw drive throughput/latency (diskbench <drive> [MB] [start_lba])"},
+    {"fsbench", "FAT read/write and metadata benchmark on the mounted volume"},
+    {"bcache", "Block cache stats (bcache size N, bcache reset)"},
+    {"sync", "Write cached disk blocks to disk"},
     {"fat", "Enter FAT shell mode"},
     {"mkrootfs", "Create root filesystem on disk"},
     {"crash", "Trigger kernel panic by dividing by zero"},
@@ -1,8 +1,24 @@
 #include "all_commands.h"
+#include "../mm/pmm.h"
+#include "../arch/i686/paging/paging.h"
 #include "../utils/string.h"
 #include "../drivers/vga/vga.h"
 #include "../drivers/vga/colors.h"
 
+static void print_count(const char* label, uint32_t value) {
+    char buf[16];
+    vga_print(label);
+    itoa((int)value, buf, 10);
+    vga_print(buf);
+}
+
+static void print_kb(const char* label, uint32_t pages) {
+    char buf[32];
+    vga_print_color(label, YELLOW);
+    itoa(pages * (PMM_PAGE_SIZE / 1024), buf, 10);
+    vga_print_color(buf, 0x0F);
+    vga_print_color(" KB\n", 0x0F);
+}
 
 void meminfo_cmd()
 {
@@ -11,4 +27,55 @@ void meminfo_cmd()
     itoa((int)&_start, buf, 16); vga_print_color("kernel start: 0x", YELLOW); vga_print_color(buf, 0x0F); vga_putc('\n');
     itoa((int)&end, buf, 16); vga_print_color("kernel end: 0x", YELLOW); vga_print_color(buf, 0x0F); vga_putc('\n');
     int ksize = (int)&end - (int)&_start; itoa(ksize, buf, 10); vga_print_color("size: ", YELLOW); vga_print_color(buf, 0x0F); vga_putc('\n');
+
+    pmm_stats_t st;
+    pmm_get_stats(&st);
+
+    static const char* const sources[] = { "multiboot mmap", "mem_lower/mem_upper", "none (assumed)" };
+    vga_print_color("memory map: ", YELLOW); vga_print_color(sources[st.source], 0x0F); vga_putc('\n');
+    print_kb("top of RAM: ", st.top / PMM_PAGE_SIZE);
+    print_kb("total: ", st.total_pages);
+    print_kb("free: ", st.free_pages);
+
+    for (int i = PMM_OWNER_FREE + 1; i < PMM_OWNER_COUNT; i++) {
+        vga_print("  ");
+        vga_print(pmm_owner_name((pmm_owner_t)i));
+        print_kb(": ", st.owner_pages[i]);
+    }
+
+    // Free blocks per order: the largest contiguous allocation that can succeed
+    vga_print_color("free blocks:", YELLOW);
+    for (int order = 0; order <= PMM_MAX_ORDER; order++) {
+        if (st.free_blocks[order] == 0) continue;
+        vga_print(" ");
+        itoa((PMM_PAGE_SIZE / 1024) << order, buf, 10);
+        vga_print(buf);
+        vga_print("K x");
+        itoa(st.free_blocks[order], buf, 10);
+        vga_print(buf);
+    }
+    vga_putc('\n');
+
+    paging_stats_t pg;
+    paging_get_stats(&pg);
+
+    vga_print_color("paging: ", YELLOW);
+    if (!pg.enabled) {
+        vga_print("off\n");
+        return;
+    }
+    vga_print(pg.pse ? "4 MB pages" : "4 KB pages only");
+    print_count(", mapped ", pg.mapped_mb);
+    print_count(" MB, large ", pg.large_pages);
+    print_count(", tables ", pg.page_tables);
+    vga_putc('\n');
+
+    vga_print_color("page faults: ", YELLOW);
+    print_count("", pg.faults);
+    print_count(" (resolved ", pg.resolved);
+    print_count(", not present ", pg.not_present);
+    print_count(", protection ", pg.protection);
+    print_count(", write ", pg.writes);
+    print_count(", exec ", pg.fetches);
+    vga_print(")\n");
 }
@@ -0,0 +1,69 @@
+#include "all_commands.h"
+#include "../drivers/block/blockdev.h"
+#include "../drivers/block/ramdisk.h"
+#include "../fs/bcache/bcache.h"
+#include "../drivers/vga/vga.h"
+#include "../utils/string.h"
+#include "../drivers/vga/colors.h"
+
+/* ramdisk <MB> [copy <drive>] */
+void cmd_ramdisk(const char* args) {
+    uint32_t mb = 0;
+    uint32_t src = 0;
+    int copy = 0;
+
+    const char* p = parse_number(args, &mb);
+    if (p) {
+        while (*p == ' ') p++;
+        if (strncmp(p, "copy", 4) == 0) {
+            p += 4;
+            while (*p == ' ') p++;
+            p = parse_number(p, &src);
+            copy = 1;
+        }
+    }
+
+    if (!p || *p != '\0' || mb == 0) {
+        vga_print_color("Usage: ramdisk <MB> [copy <drive>]\n", LIGHT_RED);
+        return;
+    }
+
+    if (copy && !blockdev_exists((uint8_t)src)) {
+        vga_print_color("Drive not found\n", LIGHT_RED);
+        return;
+    }
+
+    uint32_t sectors = mb * 2048;
+    int id = ramdisk_create(sectors);
+    if (id < 0) {
+        vga_print_color("Cannot create RAM disk (too large or too many)\n", LIGHT_RED);
+        return;
+    }
+
+    if (copy) {
+        /* Clone the start of another device, e.g. to mount a FAT image from RAM */
+        static uint8_t chunk[64 * 1024];
+        uint32_t per = sizeof(chunk) / BLOCKDEV_SECTOR_SIZE;
+        blockdev_t* from = blockdev_get((uint8_t)src);
+        uint32_t total = sectors;
+        if (from->sectors && from->sectors < total) total = from->sectors;
+
+        /* The copy reads the device directly: cached writes and readahead must settle first */
+        bcache_sync((uint8_t)src);
+
+        for (uint32_t lba = 0; lba < total; lba += per) {
+            uint32_t n = total - lba < per ? total - lba : per;
+            if (blockdev_read((uint8_t)src, lba, (uint16_t)n, chunk) < 0 ||
+                blockdev_write((uint8_t)id, lba, (uint16_t)n, chunk) < 0) {
+                vga_print_color("Copy failed\n", LIGHT_RED);
+                return;
+            }
+        }
+    }
+
+    char buf[16];
+    vga_print_color("Created RAM disk as drive ", 0x0A);
+    itoa(id, buf, 10);
+    vga_print(buf);
+    vga_putc('\n');
+}
@@ -0,0 +1,40 @@
+#include "all_commands.h"
+#include "../mm/kmalloc.h"
+#include "../mm/pmm.h"
+#include "../drivers/vga/vga.h"
+#include "../utils/string.h"
+#include "../drivers/vga/colors.h"
+
+/* Prints value right-aligned in a column of the given width */
+static void print_col(uint32_t value, int width) {
+    char buf[16];
+    itoa(value, buf, 10);
+    for (int pad = width - (int)strlen(buf); pad > 0; pad--) vga_putc(' ');
+    vga_print(buf);
+}
+
+void cmd_slabinfo(void) {
+    vga_print_color("cache          size  active   total  slabs     allocs   fail\n", YELLOW);
+
+    for (int i = 0; i < kmem_cache_count(); i++) {
+        const kmem_cache_t* c = kmem_cache_get(i);
+
+        vga_print(c->name);
+        for (int pad = 13 - (int)strlen(c->name); pad > 0; pad--) vga_putc(' ');
+        print_col(c->obj_size, 6);
+        print_col(c->active, 8);
+        print_col(c->slabs * c->objs_per_slab, 8);
+        print_col(c->slabs, 7);
+        print_col(c->allocs, 11);
+        print_col(c->failures, 7);
+        vga_putc('\n');
+    }
+
+    uint32_t blocks, pages;
+    kmalloc_large_stats(&blocks, &pages);
+    vga_print_color("large blocks: ", YELLOW);
+    print_col(blocks, 0);
+    vga_print(" (");
+    print_col(pages * (PMM_PAGE_SIZE / 1024), 0);
+    vga_print(" KB)\n");
+}
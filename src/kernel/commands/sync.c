@@ -0,0 +1,10 @@
+#include "all_commands.h"
+#include "../fs/bcache/bcache.h"
+#include "../drivers/vga/vga.h"
+#include "../drivers/vga/colors.h"
+
+void cmd_sync(void) {
+    if (bcache_sync(BCACHE_ALL_DRIVES) < 0) {
+        vga_print_color("Sync failed\n", LIGHT_RED);
+    }
+}
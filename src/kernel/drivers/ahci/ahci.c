@@ -0,0 +1,420 @@
+#include "ahci.h"
+#include "../block/blockdev.h"
+#include "../pci/pci.h"
+#include "../../arch/i686/idt/isr.h"
+#include "../../arch/i686/timer/timer.h"
+#include "../../arch/i686/paging/paging.h"
+#include "../../utils/string.h"
+
+/* A command (or a queue of them) must finish within this time */
+#define AHCI_TIMEOUT_MS     5000
+
+typedef struct {
+    volatile uint8_t*   regs;           /* This port's register block */
+    uint8_t             port;
+    uint8_t             ncq;            /* Both HBA and drive do NCQ */
+    uint8_t             depth;          /* Commands kept in flight */
+    uint32_t            sectors;
+    uint32_t            busy;           /* Slots issued and not yet completed */
+    volatile uint32_t   is;             /* PxIS bits collected since the last check */
+
+    ahci_cmd_header_t*  cmd_list;
+    ahci_cmd_table_t*   tables;
+    uint32_t            req_of[AHCI_MAX_SLOTS];     /* Batch index per slot */
+    char                model[41];
+} ahci_port_t;
+
+static volatile uint8_t* ahci_abar = 0;
+static uint8_t ahci_irq = 0;
+static uint8_t ahci_slots = 1;
+static uint8_t ahci_hba_ncq = 0;
+
+static ahci_port_t ahci_ports[AHCI_MAX_PORTS];
+static int ahci_port_count = 0;
+
+/* Per-port DMA structures: command list 1 KB aligned, FIS area 256 bytes aligned */
+static ahci_cmd_header_t ahci_cmd_lists[AHCI_MAX_PORTS][AHCI_MAX_SLOTS] __attribute__((aligned(1024)));
+static uint8_t ahci_fis_areas[AHCI_MAX_PORTS][256] __attribute__((aligned(256)));
+static ahci_cmd_table_t ahci_tables[AHCI_MAX_PORTS][AHCI_MAX_SLOTS] __attribute__((aligned(128)));
+
+static const char* const ahci_names[AHCI_MAX_PORTS] = { "sd0", "sd1", "sd2", "sd3" };
+
+static inline uint32_t ahci_read(volatile uint8_t* base, uint32_t reg) {
+    return *(volatile uint32_t*)(base + reg);
+}
+
+static inline void ahci_write(volatile uint8_t* base, uint32_t reg, uint32_t value) {
+    *(volatile uint32_t*)(base + reg) = value;
+}
+
+static int ahci_interrupts_enabled(void) {
+    uint32_t flags;
+    __asm__ volatile ("pushfl; popl %0" : "=r"(flags));
+    return (flags & 0x200) != 0;
+}
+
+/* Move the port's interrupt status into p->is and acknowledge it */
+static void ahci_port_collect(ahci_port_t* p) {
+    uint32_t is = ahci_read(p->regs, AHCI_PxIS);
+    if (is) {
+        ahci_write(p->regs, AHCI_PxIS, is);
+        p->is |= is;
+    }
+}
+
+static void ahci_irq_handler(void* ctx) {
+    (void)ctx;
+    uint32_t pending = ahci_read(ahci_abar, AHCI_IS);
+
+    for (int i = 0; i < ahci_port_count; i++) {
+        ahci_port_t* p = &ahci_ports[i];
+        if (pending & (1u << p->port)) ahci_port_collect(p);
+    }
+    ahci_write(ahci_abar, AHCI_IS, pending);
+}
+
+static int ahci_port_stop(ahci_port_t* p) {
+    uint32_t cmd = ahci_read(p->regs, AHCI_PxCMD);
+    ahci_write(p->regs, AHCI_PxCMD, cmd & ~(AHCI_PxCMD_ST | AHCI_PxCMD_FRE));
+
+    for (int i = 0; i < 1000000; i++) {
+        if (!(ahci_read(p->regs, AHCI_PxCMD) & (AHCI_PxCMD_CR | AHCI_PxCMD_FR))) return 0;
+    }
+    return -1;
+}
+
+static void ahci_port_start(ahci_port_t* p) {
+    for (int i = 0; i < 1000000; i++) {
+        if (!(ahci_read(p->regs, AHCI_PxCMD) & AHCI_PxCMD_CR)) break;
+    }
+
+    uint32_t cmd = ahci_read(p->regs, AHCI_PxCMD);
+    ahci_write(p->regs, AHCI_PxCMD, cmd | AHCI_PxCMD_FRE);
+    ahci_write(p->regs, AHCI_PxCMD, cmd | AHCI_PxCMD_FRE | AHCI_PxCMD_ST);
+}
+
+/* After a task file error the port must be restarted before it takes new commands */
+static void ahci_port_recover(ahci_port_t* p) {
+    ahci_port_stop(p);
+    ahci_write(p->regs, AHCI_PxSERR, 0xFFFFFFFF);
+    ahci_write(p->regs, AHCI_PxIS, 0xFFFFFFFF);
+    p->is = 0;
+    p->busy = 0;
+    ahci_port_start(p);
+}
+
+/*
+ * Build the command in `slot` and hand it to the HBA. Queued commands
+ * (NCQ) carry the slot as their tag and the sector count in the feature
+ * registers; PxSACT is set before PxCI as the spec requires.
+ */
+static int ahci_issue(ahci_port_t* p, uint8_t slot, uint8_t command, uint32_t lba,
+                      uint16_t count, void* buffer, uint32_t bytes, int write) {
+    ahci_cmd_header_t* hdr = &p->cmd_list[slot];
+    ahci_cmd_table_t* tbl = &p->tables[slot];
+    uint32_t addr = (uint32_t)(uintptr_t)buffer;
+    uint16_t n = 0;
+
+    /* Data base addresses must be word aligned */
+    if (addr & 1) return -1;
+
+    memset(tbl, 0, sizeof(ahci_cmd_table_t));
+    while (bytes > 0) {
+        if (n == AHCI_PRD_ENTRIES) return -1;
+        uint32_t chunk = bytes > AHCI_PRD_MAX_BYTES ? AHCI_PRD_MAX_BYTES : bytes;
+        tbl->prdt[n].dba = addr;
+        tbl->prdt[n].dbau = 0;
+        tbl->prdt[n].dbc = chunk - 1;
+        addr += chunk;
+        bytes -= chunk;
+        n++;
+    }
+
+    int queued = command == AHCI_CMD_READ_FPDMA || command == AHCI_CMD_WRITE_FPDMA;
+    ahci_fis_h2d_t* fis = (ahci_fis_h2d_t*)tbl->cfis;
+    fis->type = AHCI_FIS_H2D;
+    fis->flags = 0x80;
+    fis->command = command;
+    fis->device = 0x40;                 /* LBA mode */
+    fis->lba0 = (uint8_t)lba;
+    fis->lba1 = (uint8_t)(lba >> 8);
+    fis->lba2 = (uint8_t)(lba >> 16);
+    fis->lba3 = (uint8_t)(lba >> 24);
+    if (queued) {
+        fis->feature_lo = (uint8_t)count;
+        fis->feature_hi = (uint8_t)(count >> 8);
+        fis->count_lo = (uint8_t)(slot << 3);
+    } else {
+        fis->count_lo = (uint8_t)count;
+        fis->count_hi = (uint8_t)(count >> 8);
+    }
+
+    hdr->flags = (uint16_t)(sizeof(ahci_fis_h2d_t) / 4) | (write ? AHCI_CMD_HDR_WRITE : 0);
+    hdr->prdtl = n;
+    hdr->prdbc = 0;
+    hdr->ctba = (uint32_t)(uintptr_t)tbl;
+    hdr->ctbau = 0;
+
+    /* Table and header must be in memory before the HBA fetches them */
+    __asm__ volatile ("" ::: "memory");
+
+    if (queued) ahci_write(p->regs, AHCI_PxSACT, 1u << slot);
+    ahci_write(p->regs, AHCI_PxCI, 1u << slot);
+    p->busy |= 1u << slot;
+    return 0;
+}
+
+/* Slots that are still running: NCQ completion clears PxSACT, others PxCI */
+static uint32_t ahci_running(ahci_port_t* p) {
+    return ahci_read(p->regs, p->ncq ? AHCI_PxSACT : AHCI_PxCI) |
+           ahci_read(p->regs, AHCI_PxCI);
+}
+
+/*
+ * Wait until at least one busy slot completes. Returns the completed
+ * slots, or 0 on error or timeout (the port is then recovered and every
+ * outstanding command counts as failed).
+ */
+static uint32_t ahci_wait_any(ahci_port_t* p) {
+    uint32_t freq = get_timer_frequency();
+    uint32_t start = get_ticks();
+    uint32_t limit = (AHCI_TIMEOUT_MS * freq) / 1000 + 1;
+    int sleep = ahci_interrupts_enabled() && freq != 0 && ahci_irq != 0;
+    uint32_t spins = 0;
+
+    for (;;) {
+        ahci_port_collect(p);
+        if (p->is & AHCI_PxIS_ERRORS) break;
+
+        uint32_t done = p->busy & ~ahci_running(p);
+        if (done) {
+            p->busy &= ~done;
+            return done;
+        }
+
+        if (sleep) {
+            /* cli/sti+hlt closes the window between the check and the halt */
+            __asm__ volatile ("cli");
+            if (get_ticks() - start > limit) {
+                __asm__ volatile ("sti");
+                break;
+            }
+            if (p->busy & ahci_running(p)) __asm__ volatile ("sti; hlt");
+            else __asm__ volatile ("sti");
+        } else if (++spins > 100000000) {
+            break;
+        }
+    }
+
+    ahci_port_recover(p);
+    return 0;
+}
+
+/* Run one command to completion on slot 0 (IDENTIFY, FLUSH, unqueued I/O) */
+static int ahci_exec(ahci_port_t* p, uint8_t command, uint32_t lba, uint16_t count,
+                     void* buffer, uint32_t bytes, int write) {
+    uint8_t ncq = p->ncq;
+    p->ncq = 0;
+    p->is = 0;
+
+    int rc = -1;
+    if (ahci_issue(p, 0, command, lba, count, buffer, bytes, write) == 0 && ahci_wait_any(p)) {
+        rc = (ahci_read(p->regs, AHCI_PxTFD) & AHCI_TFD_ERR) ? -1 : 0;
+    }
+
+    p->ncq = ncq;
+    return rc;
+}
+
+/*
+ * Keep up to `depth` commands outstanding: whenever a slot completes, the
+ * next request of the batch is issued into it. Without NCQ the depth is 1.
+ */
+static int ahci_submit(blockdev_t* dev, blockdev_request_t* reqs, uint32_t count) {
+    ahci_port_t* p = (ahci_port_t*)dev->priv;
+    uint32_t next = 0;
+    int result = 0;
+
+    p->is = 0;
+    while (next < count || p->busy) {
+        while (next < count) {
+            uint32_t inflight = 0;
+            for (uint32_t b = p->busy; b; b &= b - 1) inflight++;
+            if (inflight >= p->depth) break;
+
+            uint8_t slot = 0;
+            while (p->busy & (1u << slot)) slot++;
+
+            blockdev_request_t* r = &reqs[next];
+            uint8_t command;
+            if (p->ncq) command = r->write ? AHCI_CMD_WRITE_FPDMA : AHCI_CMD_READ_FPDMA;
+            else command = r->write ? AHCI_CMD_WRITE_DMA_EXT : AHCI_CMD_READ_DMA_EXT;
+
+            if (ahci_issue(p, slot, command, r->lba, r->count, r->buffer,
+                           (uint32_t)r->count * BLOCKDEV_SECTOR_SIZE, r->write) < 0) {
+                r->status = -1;
+                result = -1;
+            } else {
+                p->req_of[slot] = next;
+            }
+            next++;
+        }
+
+        if (!p->busy) continue;
+
+        uint32_t outstanding = p->busy;
+        uint32_t done = ahci_wait_any(p);
+        if (!done) {
+            /* The port was reset: everything that was in flight failed */
+            for (uint8_t s = 0; s < AHCI_MAX_SLOTS; s++) {
+                if (outstanding & (1u << s)) reqs[p->req_of[s]].status = -1;
+            }
+            result = -1;
+            continue;
+        }
+
+        for (uint8_t s = 0; s < AHCI_MAX_SLOTS; s++) {
+            if (done & (1u << s)) reqs[p->req_of[s]].status = 0;
+        }
+    }
+
+    return result;
+}
+
+static int ahci_read_op(blockdev_t* dev, uint32_t lba, uint16_t count, void* buffer) {
+    blockdev_request_t req = { lba, count, 0, buffer, 0 };
+    return ahci_submit(dev, &req, 1);
+}
+
+static int ahci_write_op(blockdev_t* dev, uint32_t lba, uint16_t count, const void* buffer) {
+    blockdev_request_t req = { lba, count, 1, (void*)buffer, 0 };
+    return ahci_submit(dev, &req, 1);
+}
+
+static int ahci_flush_op(blockdev_t* dev) {
+    ahci_port_t* p = (ahci_port_t*)dev->priv;
+    return ahci_exec(p, AHCI_CMD_FLUSH_EXT, 0, 0, NULL, 0, 0);
+}
+
+static const blockdev_ops_t ahci_ops = {
+    ahci_read_op,
+    ahci_write_op,
+    ahci_flush_op,
+    ahci_submit,
+    NULL,
+    NULL,
+};
+
+static int ahci_port_setup(ahci_port_t* p, uint8_t port) {
+    volatile uint8_t* regs = ahci_abar + AHCI_PORT_BASE + port * AHCI_PORT_SIZE;
+
+    /* Only a device that is present with the link up, and a disk rather than ATAPI */
+    uint32_t ssts = ahci_read(regs, AHCI_PxSSTS);
+    if ((ssts & 0x0F) != AHCI_SSTS_DET_PRESENT) return -1;
+    if (((ssts >> 8) & 0x0F) != AHCI_SSTS_IPM_ACTIVE) return -1;
+    if (ahci_read(regs, AHCI_PxSIG) != AHCI_SIG_ATA) return -1;
+
+    int idx = ahci_port_count;
+    memset(p, 0, sizeof(ahci_port_t));
+    p->regs = regs;
+    p->port = port;
+    p->cmd_list = ahci_cmd_lists[idx];
+    p->tables = ahci_tables[idx];
+
+    if (ahci_port_stop(p) < 0) return -1;
+
+    memset(ahci_cmd_lists[idx], 0, sizeof(ahci_cmd_lists[idx]));
+    memset(ahci_fis_areas[idx], 0, sizeof(ahci_fis_areas[idx]));
+    ahci_write(regs, AHCI_PxCLB, (uint32_t)(uintptr_t)ahci_cmd_lists[idx]);
+    ahci_write(regs, AHCI_PxCLBU, 0);
+    ahci_write(regs, AHCI_PxFB, (uint32_t)(uintptr_t)ahci_fis_areas[idx]);
+    ahci_write(regs, AHCI_PxFBU, 0);
+
+    ahci_write(regs, AHCI_PxSERR, 0xFFFFFFFF);
+    ahci_write(regs, AHCI_PxIS, 0xFFFFFFFF);
+    ahci_write(regs, AHCI_PxIE, AHCI_PxIS_DHRS | AHCI_PxIS_PSS | AHCI_PxIS_DSS |
+                                AHCI_PxIS_SDBS | AHCI_PxIS_ERRORS);
+    ahci_port_start(p);
+
+    static uint16_t identify[256];
+    if (ahci_exec(p, AHCI_CMD_IDENTIFY, 0, 0, identify, sizeof(identify), 0) < 0) return -1;
+
+    if (identify[83] & (1 << 10)) {
+        /* 48-bit capacity; sectors past 2^32 are not addressable here */
+        if (identify[102] || identify[103]) p->sectors = 0xFFFFFFFF;
+        else p->sectors = ((uint32_t)identify[101] << 16) | identify[100];
+    } else {
+        p->sectors = ((uint32_t)identify[61] << 16) | identify[60];
+    }
+
+    /* Word 76 bit 8: NCQ, word 75: queue depth - 1 */
+    p->ncq = ahci_hba_ncq && (identify[76] & (1 << 8));
+    p->depth = 1;
+    if (p->ncq) {
+        p->depth = (uint8_t)((identify[75] & 0x1F) + 1);
+        if (p->depth > ahci_slots) p->depth = ahci_slots;
+    }
+
+    for (int i = 0; i < 40; i += 2) {
+        p->model[i] = (char)(identify[27 + i / 2] >> 8);
+        p->model[i + 1] = (char)(identify[27 + i / 2] & 0xFF);
+    }
+    p->model[40] = '\0';
+    for (int i = 39; i >= 0 && p->model[i] == ' '; i--) p->model[i] = '\0';
+
+    return 0;
+}
+
+int ahci_init(void) {
+    static uint8_t probed = 0;
+    if (probed) return ahci_port_count;
+    probed = 1;
+
+    pci_location_t loc;
+    if (pci_find_class(AHCI_PCI_CLASS, AHCI_PCI_SUBCLASS, &loc) < 0) return 0;
+
+    uint8_t prog_if = (uint8_t)(pci_config_read_word(loc.bus, loc.slot, loc.func, 0x08) >> 8);
+    if (prog_if != 0x01) return 0;
+
+    uint32_t bar5 = pci_config_read_dword(loc.bus, loc.slot, loc.func, AHCI_PCI_BAR);
+    if (bar5 & 1) return 0;     /* Expect memory space */
+
+    /* Enable memory decoding and bus mastering */
+    uint16_t cmd = pci_config_read_word(loc.bus, loc.slot, loc.func, 0x04);
+    pci_config_write_word(loc.bus, loc.slot, loc.func, 0x04, cmd | 0x06);
+
+    /* The HBA usually sits above RAM, outside the identity map */
+    if (paging_map_mmio(bar5 & 0xFFFFFFF0, AHCI_PORT_BASE + 32 * AHCI_PORT_SIZE) < 0) return 0;
+    ahci_abar = (volatile uint8_t*)(uintptr_t)(bar5 & 0xFFFFFFF0);
+    ahci_write(ahci_abar, AHCI_GHC, ahci_read(ahci_abar, AHCI_GHC) | AHCI_GHC_AE);
+
+    uint32_t cap = ahci_read(ahci_abar, AHCI_CAP);
+    ahci_slots = (uint8_t)(((cap >> AHCI_CAP_NCS_SHIFT) & 0x1F) + 1);
+    ahci_hba_ncq = (cap & AHCI_CAP_SNCQ) != 0;
+
+    ahci_irq = (uint8_t)(pci_config_read_word(loc.bus, loc.slot, loc.func, 0x3C) & 0xFF);
+    if (ahci_irq >= 16) ahci_irq = 0;
+
+    uint32_t implemented = ahci_read(ahci_abar, AHCI_PI);
+    for (uint8_t port = 0; port < 32 && ahci_port_count < AHCI_MAX_PORTS; port++) {
+        if (!(implemented & (1u << port))) continue;
+
+        ahci_port_t* p = &ahci_ports[ahci_port_count];
+        if (ahci_port_setup(p, port) < 0) continue;
+
+        blockdev_add(BLOCKDEV_ANY, ahci_names[ahci_port_count], p->model,
+                     p->sectors, p->depth, &ahci_ops, p);
+        ahci_port_count++;
+    }
+
+    /* Interrupts only with a handler installed; otherwise ahci_wait_any polls */
+    if (ahci_port_count > 0 && ahci_irq) {
+        if (irq_register_handler(ahci_irq, ahci_irq_handler, NULL) == 0) {
+            ahci_write(ahci_abar, AHCI_GHC, ahci_read(ahci_abar, AHCI_GHC) | AHCI_GHC_IE);
+        } else {
+            ahci_irq = 0;
+        }
+    }
+
+    return ahci_port_count;
+}
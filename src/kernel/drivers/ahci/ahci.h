@@ -0,0 +1,126 @@
+#ifndef AHCI_H
+#define AHCI_H
+
+#include <stdint.h>
+
+/* PCI class 01h (mass storage), subclass 06h (SATA), prog-if 01h (AHCI 1.0) */
+#define AHCI_PCI_CLASS          0x01
+#define AHCI_PCI_SUBCLASS       0x06
+#define AHCI_PCI_BAR            0x24    /* BAR5: ABAR, HBA registers in memory space */
+
+/* Generic host control registers */
+#define AHCI_CAP                0x00
+#define AHCI_GHC                0x04
+#define AHCI_IS                 0x08
+#define AHCI_PI                 0x0C
+
+#define AHCI_CAP_NCS_SHIFT      8       /* Command slots - 1, bits 8..12 */
+#define AHCI_CAP_SNCQ           (1u << 30)
+
+#define AHCI_GHC_IE             (1u << 1)
+#define AHCI_GHC_AE             (1u << 31)
+
+/* Port registers, at 0x100 + port * 0x80 */
+#define AHCI_PORT_BASE          0x100
+#define AHCI_PORT_SIZE          0x80
+
+#define AHCI_PxCLB              0x00
+#define AHCI_PxCLBU             0x04
+#define AHCI_PxFB               0x08
+#define AHCI_PxFBU              0x0C
+#define AHCI_PxIS               0x10
+#define AHCI_PxIE               0x14
+#define AHCI_PxCMD              0x18
+#define AHCI_PxTFD              0x20
+#define AHCI_PxSIG              0x24
+#define AHCI_PxSSTS             0x28
+#define AHCI_PxSERR             0x30
+#define AHCI_PxSACT             0x34
+#define AHCI_PxCI               0x38
+
+#define AHCI_PxCMD_ST           (1u << 0)
+#define AHCI_PxCMD_FRE          (1u << 4)
+#define AHCI_PxCMD_FR           (1u << 14)
+#define AHCI_PxCMD_CR           (1u << 15)
+
+#define AHCI_PxIS_DHRS          (1u << 0)   /* D2H register FIS */
+#define AHCI_PxIS_PSS           (1u << 1)   /* PIO setup FIS */
+#define AHCI_PxIS_DSS           (1u << 2)   /* DMA setup FIS */
+#define AHCI_PxIS_SDBS          (1u << 3)   /* Set device bits FIS (NCQ completion) */
+#define AHCI_PxIS_TFES          (1u << 30)  /* Task file error */
+#define AHCI_PxIS_ERRORS        0x78000000u /* TFES, HBFS, HBDS, IFS */
+
+#define AHCI_TFD_ERR            0x01
+#define AHCI_TFD_DRQ            0x08
+#define AHCI_TFD_BSY            0x80
+
+#define AHCI_SIG_ATA            0x00000101
+
+#define AHCI_SSTS_DET_PRESENT   3
+#define AHCI_SSTS_IPM_ACTIVE    1
+
+/* ATA commands issued through the HBA */
+#define AHCI_CMD_IDENTIFY       0xEC
+#define AHCI_CMD_READ_DMA_EXT   0x25
+#define AHCI_CMD_WRITE_DMA_EXT  0x35
+#define AHCI_CMD_READ_FPDMA     0x60    /* NCQ */
+#define AHCI_CMD_WRITE_FPDMA    0x61    /* NCQ */
+#define AHCI_CMD_FLUSH_EXT      0xEA
+
+#define AHCI_FIS_H2D            0x27
+
+typedef struct __attribute__((packed)) {
+    uint8_t     type;
+    uint8_t     flags;          /* Bit 7: command (not control) */
+    uint8_t     command;
+    uint8_t     feature_lo;
+    uint8_t     lba0;
+    uint8_t     lba1;
+    uint8_t     lba2;
+    uint8_t     device;
+    uint8_t     lba3;
+    uint8_t     lba4;
+    uint8_t     lba5;
+    uint8_t     feature_hi;
+    uint8_t     count_lo;
+    uint8_t     count_hi;
+    uint8_t     icc;
+    uint8_t     control;
+    uint8_t     reserved[4];
+} ahci_fis_h2d_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t    flags;          /* CFL in bits 0..4, W = bit 6 */
+    uint16_t    prdtl;          /* PRD entries */
+    volatile uint32_t prdbc;    /* Bytes transferred */
+    uint32_t    ctba;
+    uint32_t    ctbau;
+    uint32_t    reserved[4];
+} ahci_cmd_header_t;
+
+#define AHCI_CMD_HDR_WRITE      (1 << 6)
+
+typedef struct __attribute__((packed)) {
+    uint32_t    dba;
+    uint32_t    dbau;
+    uint32_t    reserved;
+    uint32_t    dbc;            /* Byte count - 1 in bits 0..21, bit 31: interrupt */
+} ahci_prd_t;
+
+#define AHCI_PRD_MAX_BYTES      (4 * 1024 * 1024)
+#define AHCI_PRD_ENTRIES        8   /* 65535 sectors of contiguous buffer */
+
+typedef struct __attribute__((packed)) {
+    uint8_t     cfis[64];
+    uint8_t     acmd[16];
+    uint8_t     reserved[48];
+    ahci_prd_t  prdt[AHCI_PRD_ENTRIES];
+} ahci_cmd_table_t;
+
+#define AHCI_MAX_PORTS          4
+#define AHCI_MAX_SLOTS          32
+
+/* Find the AHCI controller and register every SATA disk as a block device */
+int ahci_init(void);
+
+#endif
@@ -1,11 +1,48 @@
 #include "ata.h"
+#include "../pci/pci.h"
+#include "../../arch/i686/pic/pic.h"
+#include "../../arch/i686/timer/timer.h"
 #include "../../utils/ports.h"
 #include "../../utils/string.h"
 
+/* Bus-master transfer must complete within this time */
+#define ATA_DMA_TIMEOUT_MS  2000
+/* Per-sector PIO step (and cache flush) must complete within this time */
+#define ATA_PIO_TIMEOUT_MS  1000
+/* A drive that answers at all leaves BSY this soon after reset or IDENTIFY */
+#define ATA_PROBE_TIMEOUT_MS 500
+
+typedef struct {
+    uint16_t            io_base;
+    uint16_t            ctrl_base;
+    uint16_t            bm_base;        /* 0 = no bus-master DMA */
+    uint8_t             dma_active;     /* Current command is a DMA one */
+    volatile uint8_t    irq_fired;
+    volatile uint8_t    irq_status;     /* ATA status read by the IRQ handler */
+    volatile uint8_t    bm_status;      /* Bus-master status read by the IRQ handler */
+    uint8_t             dma_dir;        /* Bus-master direction of the running command */
+    uint8_t             async_drive;    /* Owner of a started transfer, ATA_ASYNC_NONE if idle */
+    int8_t              async_status;   /* Its result once collected, 1 while still running */
+} ata_channel_t;
+
+#define ATA_ASYNC_NONE      0xFF
+
 /* Up to 4 drives: primary master/slave, secondary master/slave */
 static ata_device_t ata_devices[4];
 static int ata_initialized = 0;
 
+/* Drives whose reset signature says disk, and those IDENTIFY has been run on (bit per drive) */
+static uint8_t ata_detected = 0;
+static uint8_t ata_identified = 0;
+
+static ata_channel_t ata_channels[2] = {
+    { ATA_PRIMARY_DATA,   ATA_PRIMARY_CTRL,   0, 0, 0, 0, 0, 0, ATA_ASYNC_NONE, 0 },
+    { ATA_SECONDARY_DATA, ATA_SECONDARY_CTRL, 0, 0, 0, 0, 0, 0, ATA_ASYNC_NONE, 0 },
+};
+
+/* One PRD table per channel; aligning to its size keeps it inside a 64 KB window */
+static ata_prd_t ata_prdt[2][ATA_PRD_ENTRIES] __attribute__((aligned(ATA_PRD_ENTRIES * 8)));
+
 /* I/O delay */
 static void ata_io_wait(uint16_t ctrl_port) {
     inb(ctrl_port);
@@ -14,27 +51,63 @@ static void ata_io_wait(uint16_t ctrl_port) {
     inb(ctrl_port);
 }
 
-/* Wait for BSY to clear */
-static int ata_wait_bsy(uint16_t status_port) {
-    int timeout = 100000;
-    while ((inb(status_port) & ATA_SR_BSY) && timeout > 0) {
-        timeout--;
+static int ata_interrupts_enabled(void) {
+    uint32_t flags;
+    __asm__ volatile ("pushfl; popl %0" : "=r"(flags));
+    return (flags & 0x200) != 0;
+}
+
+/*
+ * Deadline for polling loops. With the timer running it is measured in
+ * ticks; with interrupts off the ticks stand still, so the loop counts
+ * status reads instead, each of which takes about a microsecond.
+ */
+typedef struct {
+    uint32_t    start;
+    uint32_t    limit;
+    uint32_t    spins;
+    uint8_t     ticking;
+} ata_deadline_t;
+
+static void ata_deadline_set(ata_deadline_t* d, uint32_t timeout_ms) {
+    uint32_t freq = get_timer_frequency();
+    d->ticking = ata_interrupts_enabled() && freq != 0;
+    d->start = d->ticking ? get_ticks() : 0;
+    d->limit = d->ticking ? (timeout_ms * freq) / 1000 + 1 : timeout_ms * 1000;
+    d->spins = 0;
+}
+
+static int ata_deadline_passed(ata_deadline_t* d) {
+    if (d->ticking) return get_ticks() - d->start > d->limit;
+    return ++d->spins > d->limit;
+}
+
+/* Wait for BSY to clear. 0xFF is a floating bus: nothing will ever answer there */
+static int ata_wait_bsy(uint16_t status_port, uint32_t timeout_ms) {
+    ata_deadline_t d;
+    ata_deadline_set(&d, timeout_ms);
+
+    for (;;) {
+        uint8_t status = inb(status_port);
+        if (status == 0xFF) return -1;
+        if (!(status & ATA_SR_BSY)) return 0;
+        if (ata_deadline_passed(&d)) return -1;
     }
-    return timeout > 0 ? 0 : -1;
 }
 
 /* Wait for DRQ */
-static int ata_wait_drq(uint16_t status_port) {
-    int timeout = 100000;
-    uint8_t status;
-    while (timeout > 0) {
-        status = inb(status_port);
+static int ata_wait_drq(uint16_t status_port, uint32_t timeout_ms) {
+    ata_deadline_t d;
+    ata_deadline_set(&d, timeout_ms);
+
+    for (;;) {
+        uint8_t status = inb(status_port);
+        if (status == 0xFF) return -1;
         if (status & ATA_SR_ERR) return -1;
         if (status & ATA_SR_DF) return -1;
         if (status & ATA_SR_DRQ) return 0;
-        timeout--;
+        if (ata_deadline_passed(&d)) return -1;
     }
-    return -1;
 }
 
 /* Poll status after command */
@@ -42,7 +115,7 @@ static int ata_poll(uint16_t status_port) {
     /* Wait 400ns */
     for (int i = 0; i < 4; i++) inb(status_port);
 
-    if (ata_wait_bsy(status_port) < 0) return -1;
+    if (ata_wait_bsy(status_port, ATA_PIO_TIMEOUT_MS) < 0) return -1;
 
     uint8_t status = inb(status_port);
     if (status & ATA_SR_ERR) return -1;
@@ -51,15 +124,347 @@ static int ata_poll(uint16_t status_port) {
     return 0;
 }
 
-/* Software reset */
-static void ata_soft_reset(uint16_t ctrl_port) {
-    outb(ctrl_port, 0x04);  /* Set SRST */
-    ata_io_wait(ctrl_port);
-    outb(ctrl_port, 0x00);  /* Clear SRST */
-    ata_io_wait(ctrl_port);
+void ata_irq_handler(uint8_t channel) {
+    if (channel >= 2) return;
+    ata_channel_t* ch = &ata_channels[channel];
+
+    if (ch->bm_base) {
+        uint8_t bm = inb(ch->bm_base + ATA_BM_STATUS);
+        ch->bm_status = bm;
+        /* IRQ and ERR are write-1-to-clear */
+        outb(ch->bm_base + ATA_BM_STATUS, bm | ATA_BM_SR_IRQ | ATA_BM_SR_ERR);
+    }
+
+    /* Reading the status register acknowledges the interrupt on the drive */
+    ch->irq_status = inb(ch->io_base + 7);
+    ch->irq_fired = 1;
+}
+
+/* Sleep until the channel raises its IRQ; -1 on timeout */
+static int ata_wait_irq(uint8_t channel, uint32_t timeout_ms) {
+    ata_channel_t* ch = &ata_channels[channel];
+    uint32_t freq = get_timer_frequency();
+
+    if (!ata_interrupts_enabled() || freq == 0) {
+        /*
+         * Nobody will deliver the IRQ here (early boot, or called with
+         * interrupts off), so poll for the same condition the drive would
+         * interrupt on: bus-master IRQ bit for DMA, BSY clear for PIO.
+         * Alternate status is used so the poll itself does not ack anything.
+         */
+        ata_deadline_t d;
+        ata_deadline_set(&d, timeout_ms);
+
+        ata_io_wait(ch->ctrl_base);
+        for (;;) {
+            if (ch->irq_fired) return 0;
+
+            if (ch->dma_active) {
+                if (inb(ch->bm_base + ATA_BM_STATUS) & ATA_BM_SR_IRQ) {
+                    ata_irq_handler(channel);
+                    return 0;
+                }
+            } else if (!(inb(ch->ctrl_base) & ATA_SR_BSY)) {
+                ata_irq_handler(channel);
+                return 0;
+            }
+            if (ata_deadline_passed(&d)) return -1;
+        }
+    }
+
+    uint32_t start = get_ticks();
+    uint32_t limit = (timeout_ms * freq) / 1000 + 1;
+
+    for (;;) {
+        /* cli/sti+hlt closes the window between the check and the halt */
+        __asm__ volatile ("cli");
+        if (ch->irq_fired) {
+            __asm__ volatile ("sti");
+            return 0;
+        }
+        if (get_ticks() - start > limit) {
+            __asm__ volatile ("sti");
+            return -1;
+        }
+        __asm__ volatile ("sti; hlt");
+    }
+}
+
+/*
+ * Block until the drive finishes the current PIO step (a sector became
+ * ready, a written sector was taken, a non-data command completed) and
+ * check the status it interrupted with.
+ */
+static int ata_pio_wait(uint8_t channel, int need_drq) {
+    ata_channel_t* ch = &ata_channels[channel];
+
+    if (ata_wait_irq(channel, ATA_PIO_TIMEOUT_MS) < 0) return -1;
+
+    uint8_t status = ch->irq_status;
+    if (status & ATA_SR_ERR) return -1;
+    if (status & ATA_SR_DF) return -1;
+
+    /* Some drives raise the IRQ a little before DRQ is visible */
+    if (need_drq && !(status & ATA_SR_DRQ)) {
+        return ata_wait_drq(ch->io_base + 7, ATA_PIO_TIMEOUT_MS);
+    }
+    return 0;
+}
+
+/* Issue a non-data command on the selected drive and sleep until it completes */
+static int ata_pio_command(uint8_t channel, uint8_t command) {
+    ata_channel_t* ch = &ata_channels[channel];
+
+    ch->irq_fired = 0;
+    outb(ch->io_base + 7, command);
+    return ata_pio_wait(channel, 0);
+}
+
+/* LBA48 is needed past the 28-bit limit and for more than 256 sectors */
+static int ata_use_lba48(ata_device_t* dev, uint32_t lba, uint32_t count) {
+    if (!dev->lba48) return 0;
+    return count > ATA_MAX_SECTORS_LBA28 || lba + count > 0x10000000;
 }
 
-/* Identify drive */
+/*
+ * Select the drive and load LBA and sector count. In 48-bit mode each
+ * register is a two-deep FIFO: the high bytes go in first.
+ */
+static void ata_setup_lba(ata_device_t* dev, uint32_t lba, uint16_t count, int lba48) {
+    ata_channel_t* ch = &ata_channels[dev->channel];
+    uint16_t io_base = ch->io_base;
+
+    if (lba48) {
+        outb(io_base + 6, 0x40 | (dev->drive << 4));
+        ata_io_wait(ch->ctrl_base);
+
+        outb(io_base + 1, 0x00);
+        outb(io_base + 2, (uint8_t)(count >> 8));
+        outb(io_base + 3, (uint8_t)(lba >> 24));    /* LBA 24..31 */
+        outb(io_base + 4, 0x00);                    /* LBA 32..39 */
+        outb(io_base + 5, 0x00);                    /* LBA 40..47 */
+    } else {
+        outb(io_base + 6, 0xE0 | (dev->drive << 4) | ((lba >> 24) & 0x0F));
+        ata_io_wait(ch->ctrl_base);
+    }
+
+    outb(io_base + 1, 0x00);                    /* Features */
+    outb(io_base + 2, (uint8_t)count);          /* Sector count (0 = 256 in 28-bit mode) */
+    outb(io_base + 3, (uint8_t)(lba & 0xFF));           /* LBA lo */
+    outb(io_base + 4, (uint8_t)((lba >> 8) & 0xFF));    /* LBA mid */
+    outb(io_base + 5, (uint8_t)((lba >> 16) & 0xFF));   /* LBA hi */
+}
+
+/*
+ * Program the bus-master engine for a transfer straight into/out of the
+ * caller's buffer and start it. Returns 0 once the command is running,
+ * -1 if it could not be issued and 1 if the buffer cannot be described
+ * by the PRD table (caller should use PIO).
+ */
+static int ata_dma_start(ata_device_t* dev, uint32_t lba, uint16_t count, void* buffer, int write) {
+    uint8_t channel = dev->channel;
+    ata_channel_t* ch = &ata_channels[channel];
+    ata_prd_t* prdt = ata_prdt[channel];
+    uint32_t addr = (uint32_t)(uintptr_t)buffer;
+    uint32_t bytes = (uint32_t)count * ATA_SECTOR_SIZE;
+    int n = 0;
+
+    /* PRD regions must be word aligned */
+    if (addr & 1) return 1;
+
+    /* One PRD per 64 KB window the buffer touches */
+    while (bytes > 0) {
+        if (n == ATA_PRD_ENTRIES) return 1;
+
+        uint32_t chunk = 0x10000 - (addr & 0xFFFF);
+        if (chunk > bytes) chunk = bytes;
+
+        prdt[n].addr = addr;
+        prdt[n].byte_count = (uint16_t)(chunk & 0xFFFF);
+        prdt[n].flags = 0;
+
+        addr += chunk;
+        bytes -= chunk;
+        n++;
+    }
+    prdt[n - 1].flags = ATA_PRD_EOT;
+
+    uint16_t io_base = ch->io_base;
+    uint16_t bm = ch->bm_base;
+    uint8_t dir = write ? 0 : ATA_BM_CMD_READ;
+    int lba48 = ata_use_lba48(dev, lba, count);
+    uint8_t command;
+
+    if (lba48) command = write ? ATA_CMD_WRITE_DMA_EXT : ATA_CMD_READ_DMA_EXT;
+    else command = write ? ATA_CMD_WRITE_DMA : ATA_CMD_READ_DMA;
+
+    if (ata_wait_bsy(io_base + 7, ATA_PIO_TIMEOUT_MS) < 0) return -1;
+
+    /* PRDs and outgoing data must be in memory before the engine starts */
+    __asm__ volatile ("" ::: "memory");
+
+    outb(bm + ATA_BM_COMMAND, dir);
+    outl(bm + ATA_BM_PRDT, (uint32_t)(uintptr_t)prdt);
+    outb(bm + ATA_BM_STATUS, inb(bm + ATA_BM_STATUS) | ATA_BM_SR_ERR | ATA_BM_SR_IRQ);
+
+    ata_setup_lba(dev, lba, count, lba48);
+
+    ch->irq_fired = 0;
+    ch->bm_status = 0;
+    ch->dma_active = 1;
+    ch->dma_dir = dir;
+    outb(io_base + 7, command);
+    outb(bm + ATA_BM_COMMAND, dir | ATA_BM_CMD_START);
+
+    return 0;
+}
+
+/*
+ * Soft-reset both drives on the channel. This is the only way to abort a
+ * command the drive still considers outstanding; until then it ignores
+ * anything new.
+ */
+static int ata_channel_reset(uint8_t channel) {
+    ata_channel_t* ch = &ata_channels[channel];
+
+    outb(ch->ctrl_base, 0x04);
+    ata_io_wait(ch->ctrl_base);
+    /* Clearing SRST also clears nIEN, so drives interrupt */
+    outb(ch->ctrl_base, 0x00);
+    ch->irq_fired = 0;
+
+    return ata_wait_bsy(ch->ctrl_base, ATA_PROBE_TIMEOUT_MS);
+}
+
+/* Sleep until the channel's running DMA command completes and check how it ended */
+static int ata_dma_finish(uint8_t channel) {
+    ata_channel_t* ch = &ata_channels[channel];
+    uint16_t bm = ch->bm_base;
+
+    int rc = ata_wait_irq(channel, ATA_DMA_TIMEOUT_MS);
+
+    /* Stop the engine whatever happened */
+    outb(bm + ATA_BM_COMMAND, ch->dma_dir);
+    ch->dma_active = 0;
+    __asm__ volatile ("" ::: "memory");
+
+    /* Stopping the engine does not cancel the command: the drive is still waiting to move data */
+    if (rc < 0) {
+        ata_channel_reset(channel);
+        return -1;
+    }
+
+    uint8_t status = inb(ch->io_base + 7);
+    if (ch->bm_status & ATA_BM_SR_ERR) return -1;
+    if (status & (ATA_SR_ERR | ATA_SR_DF)) return -1;
+
+    return 0;
+}
+
+static int ata_dma_transfer(ata_device_t* dev, uint32_t lba, uint16_t count, void* buffer, int write) {
+    int rc = ata_dma_start(dev, lba, count, buffer, write);
+    if (rc != 0) return rc;
+    return ata_dma_finish(dev->channel);
+}
+
+/*
+ * A started transfer owns its channel until it is collected. Anything
+ * else that needs the channel completes it first and parks the result
+ * for ata_finish_transfer().
+ */
+static void ata_async_complete(uint8_t channel) {
+    ata_channel_t* ch = &ata_channels[channel];
+    if (ch->async_drive == ATA_ASYNC_NONE || ch->async_status != 1) return;
+    ch->async_status = (int8_t)ata_dma_finish(channel);
+}
+
+/* Find a PIIX-style IDE controller and take its bus-master registers */
+static void ata_dma_init(void) {
+    pci_location_t loc;
+    if (pci_find_class(0x01, 0x01, &loc) < 0) return;
+
+    uint8_t prog_if = (uint8_t)(pci_config_read_word(loc.bus, loc.slot, loc.func, 0x08) >> 8);
+
+    /* Need bus mastering, and both channels on the legacy ports we drive */
+    if (!(prog_if & 0x80)) return;
+    if (prog_if & 0x05) return;
+
+    uint32_t bar4 = pci_config_read_dword(loc.bus, loc.slot, loc.func, 0x20);
+    if (!(bar4 & 1)) return;    /* Expect I/O space */
+
+    uint16_t bm_base = (uint16_t)(bar4 & 0xFFFC);
+    if (bm_base == 0) return;
+
+    /* Enable I/O decoding and bus mastering */
+    uint16_t cmd = pci_config_read_word(loc.bus, loc.slot, loc.func, 0x04);
+    pci_config_write_word(loc.bus, loc.slot, loc.func, 0x04, cmd | 0x05);
+
+    ata_channels[0].bm_base = bm_base;
+    ata_channels[1].bm_base = bm_base + 8;
+}
+
+/*
+ * Reset both channels at once and read the signatures the drives leave
+ * in the task file. A channel whose status reads 0xFF has nothing on it
+ * (floating bus) and is skipped without waiting.
+ */
+static void ata_probe(void) {
+    uint8_t live = 0;
+
+    for (uint8_t c = 0; c < 2; c++) {
+        if (inb(ata_channels[c].ctrl_base) != 0xFF) live |= (uint8_t)(1 << c);
+    }
+
+    /* SRST is held on both channels together, so their reset times overlap */
+    for (uint8_t c = 0; c < 2; c++) {
+        if (live & (1 << c)) outb(ata_channels[c].ctrl_base, 0x04);
+    }
+    for (uint8_t c = 0; c < 2; c++) {
+        if (live & (1 << c)) ata_io_wait(ata_channels[c].ctrl_base);
+    }
+    /* Clearing SRST also clears nIEN, so drives interrupt */
+    for (uint8_t c = 0; c < 2; c++) {
+        if (live & (1 << c)) outb(ata_channels[c].ctrl_base, 0x00);
+    }
+
+    /* Both channels share one deadline instead of timing out one after another */
+    ata_deadline_t d;
+    ata_deadline_set(&d, ATA_PROBE_TIMEOUT_MS);
+    uint8_t busy = live;
+    while (busy) {
+        for (uint8_t c = 0; c < 2; c++) {
+            if (!(busy & (1 << c))) continue;
+            uint8_t status = inb(ata_channels[c].ctrl_base);
+            if (status == 0xFF) live &= (uint8_t)~(1 << c);
+            if (status == 0xFF || !(status & ATA_SR_BSY)) busy &= (uint8_t)~(1 << c);
+        }
+        if (busy && ata_deadline_passed(&d)) {
+            live &= (uint8_t)~busy;
+            break;
+        }
+    }
+
+    for (uint8_t c = 0; c < 2; c++) {
+        if (!(live & (1 << c))) continue;
+        uint16_t io_base = ata_channels[c].io_base;
+
+        for (uint8_t drive = 0; drive < 2; drive++) {
+            outb(io_base + 6, 0xA0 | (drive << 4));
+            ata_io_wait(ata_channels[c].ctrl_base);
+
+            uint8_t status = inb(io_base + 7);
+            if (status == 0 || status == 0xFF) continue;
+            if (ata_wait_bsy(io_base + 7, ATA_PROBE_TIMEOUT_MS) < 0) continue;
+
+            /* 00/00 in LBA mid/hi is a disk; ATAPI (14/EB) and others are left alone */
+            if (inb(io_base + 4) == 0 && inb(io_base + 5) == 0) {
+                ata_detected |= (uint8_t)(1 << (c * 2 + drive));
+            }
+        }
+    }
+}
+
+/* Identify drive (run on its first use, see ata_ensure) */
 static int ata_identify(uint8_t channel, uint8_t drive, ata_device_t* dev) {
     uint16_t io_base = (channel == 0) ? ATA_PRIMARY_DATA : ATA_SECONDARY_DATA;
     uint16_t ctrl_base = (channel == 0) ? ATA_PRIMARY_CTRL : ATA_SECONDARY_CTRL;
@@ -83,10 +488,10 @@ static int ata_identify(uint8_t channel, uint8_t drive, ata_device_t* dev) {
 
     /* Check if drive exists */
     uint8_t status = inb(io_base + 7);
-    if (status == 0) return -1;  /* No drive */
+    if (status == 0 || status == 0xFF) return -1;  /* No drive */
 
     /* Wait for BSY to clear */
-    if (ata_wait_bsy(io_base + 7) < 0) return -1;
+    if (ata_wait_bsy(io_base + 7, ATA_PROBE_TIMEOUT_MS) < 0) return -1;
 
     /* Check for ATAPI */
     uint8_t lba_mid = inb(io_base + 4);
@@ -97,7 +502,7 @@ static int ata_identify(uint8_t channel, uint8_t drive, ata_device_t* dev) {
     }
 
     /* Wait for DRQ or ERR */
-    if (ata_wait_drq(io_base + 7) < 0) return -1;
+    if (ata_wait_drq(io_base + 7, ATA_PROBE_TIMEOUT_MS) < 0) return -1;
 
     /* Read identify data */
     uint16_t identify[256];
@@ -108,12 +513,15 @@ static int ata_identify(uint8_t channel, uint8_t drive, ata_device_t* dev) {
     dev->present = 1;
     dev->signature = identify[0];
     dev->capabilities = identify[49];
+    dev->dma = (identify[49] & (1 << 8)) && ata_channels[channel].bm_base;
     dev->command_sets = ((uint32_t)identify[83] << 16) | identify[82];
 
     /* Get size */
     if (dev->command_sets & (1 << 26)) {
-        /* 48-bit LBA */
-        dev->size = ((uint32_t)identify[103] << 16) | identify[102];
+        /* 48-bit LBA: words 100..103, sectors past 2^32 are not addressable here */
+        dev->lba48 = 1;
+        if (identify[102] || identify[103]) dev->size = 0xFFFFFFFF;
+        else dev->size = ((uint32_t)identify[101] << 16) | identify[100];
     } else {
         /* 28-bit LBA */
         dev->size = ((uint32_t)identify[61] << 16) | identify[60];
@@ -135,74 +543,78 @@ static int ata_identify(uint8_t channel, uint8_t drive, ata_device_t* dev) {
     return 0;
 }
 
+/*
+ * IDENTIFY is deferred until a drive is first used: the probe only reads
+ * reset signatures, and positions nobody touches never cost a command.
+ */
+static int ata_ensure(uint8_t drive) {
+    if (drive >= 4 || !(ata_detected & (1 << drive))) return -1;
+
+    if (!(ata_identified & (1 << drive))) {
+        /* The channel may be busy with a started transfer of the other drive */
+        ata_async_complete(drive / 2);
+        ata_identified |= (uint8_t)(1 << drive);
+        ata_identify(drive / 2, drive % 2, &ata_devices[drive]);
+    }
+    return ata_devices[drive].present ? 0 : -1;
+}
+
 int ata_init(void) {
     if (ata_initialized) return 0;
 
     memset(ata_devices, 0, sizeof(ata_devices));
 
-    /* Reset both channels */
-    ata_soft_reset(ATA_PRIMARY_CTRL);
-    ata_soft_reset(ATA_SECONDARY_CTRL);
-
-    /* Identify all drives */
-    int found = 0;
-
-    /* Primary Master (drive 0) */
-    if (ata_identify(0, 0, &ata_devices[0]) == 0) found++;
-
-    /* Primary Slave (drive 1) */
-    if (ata_identify(0, 1, &ata_devices[1]) == 0) found++;
+    ata_dma_init();
+    ata_probe();
 
-    /* Secondary Master (drive 2) */
-    if (ata_identify(1, 0, &ata_devices[2]) == 0) found++;
+    /* Completion of every command is now signalled on IRQ14/IRQ15 */
+    pic_clear_mask(IRQ_CASCADE);
+    pic_clear_mask(IRQ_ATA1);
+    pic_clear_mask(IRQ_ATA2);
 
-    /* Secondary Slave (drive 3) */
-    if (ata_identify(1, 1, &ata_devices[3]) == 0) found++;
+    int found = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        if (ata_detected & (1 << i)) found++;
+    }
 
     ata_initialized = 1;
     return found;
 }
 
-int ata_drive_exists(uint8_t drive) {
+int ata_drive_detected(uint8_t drive) {
     if (drive >= 4) return 0;
-    return ata_devices[drive].present;
+    return (ata_detected & (1 << drive)) != 0;
+}
+
+int ata_drive_exists(uint8_t drive) {
+    return ata_ensure(drive) == 0;
 }
 
 ata_device_t* ata_get_device(uint8_t drive) {
-    if (drive >= 4) return NULL;
-    if (!ata_devices[drive].present) return NULL;
+    if (ata_ensure(drive) < 0) return NULL;
     return &ata_devices[drive];
 }
 
-int ata_read_sectors(uint8_t drive, uint32_t lba, uint8_t count, void* buffer) {
-    if (drive >= 4 || !ata_devices[drive].present) return -1;
-    if (count == 0) return -1;
-
-    ata_device_t* dev = &ata_devices[drive];
-    uint16_t io_base = (dev->channel == 0) ? ATA_PRIMARY_DATA : ATA_SECONDARY_DATA;
-    uint16_t ctrl_base = (dev->channel == 0) ? ATA_PRIMARY_CTRL : ATA_SECONDARY_CTRL;
+static int ata_pio_read(ata_device_t* dev, uint32_t lba, uint16_t count, void* buffer) {
+    ata_channel_t* ch = &ata_channels[dev->channel];
+    uint16_t io_base = ch->io_base;
+    int lba48 = ata_use_lba48(dev, lba, count);
 
     /* Wait for drive to be ready */
-    if (ata_wait_bsy(io_base + 7) < 0) return -1;
+    if (ata_wait_bsy(io_base + 7, ATA_PIO_TIMEOUT_MS) < 0) return -1;
 
-    /* Select drive with LBA mode */
-    outb(io_base + 6, 0xE0 | (dev->drive << 4) | ((lba >> 24) & 0x0F));
-    ata_io_wait(ctrl_base);
+    ata_setup_lba(dev, lba, count, lba48);
 
-    /* Send read command */
-    outb(io_base + 1, 0x00);                    /* Features */
-    outb(io_base + 2, count);                   /* Sector count */
-    outb(io_base + 3, (uint8_t)(lba & 0xFF));           /* LBA lo */
-    outb(io_base + 4, (uint8_t)((lba >> 8) & 0xFF));    /* LBA mid */
-    outb(io_base + 5, (uint8_t)((lba >> 16) & 0xFF));   /* LBA hi */
-    outb(io_base + 7, ATA_CMD_READ_PIO);        /* Command */
+    ch->irq_fired = 0;
+    outb(io_base + 7, lba48 ? ATA_CMD_READ_PIO_EXT : ATA_CMD_READ_PIO);
 
-    /* Read sectors */
+    /* Read sectors: the drive interrupts once per sector it has ready */
     uint16_t* buf = (uint16_t*)buffer;
-    for (int s = 0; s < count; s++) {
-        if (ata_poll(io_base + 7) < 0) return -1;
-        if (ata_wait_drq(io_base + 7) < 0) return -1;
+    for (uint32_t s = 0; s < count; s++) {
+        if (ata_pio_wait(dev->channel, 1) < 0) return -1;
 
+        /* Re-arm before draining: the next IRQ follows the last word */
+        ch->irq_fired = 0;
         for (int i = 0; i < 256; i++) {
             buf[s * 256 + i] = inw(io_base);
         }
@@ -211,43 +623,145 @@ int ata_read_sectors(uint8_t drive, uint32_t lba, uint8_t count, void* buffer) {
     return 0;
 }
 
-int ata_write_sectors(uint8_t drive, uint32_t lba, uint8_t count, const void* buffer) {
-    if (drive >= 4 || !ata_devices[drive].present) return -1;
+static int ata_pio_write(ata_device_t* dev, uint32_t lba, uint16_t count, const void* buffer) {
+    ata_channel_t* ch = &ata_channels[dev->channel];
+    uint16_t io_base = ch->io_base;
+    int lba48 = ata_use_lba48(dev, lba, count);
+
+    /* Wait for drive to be ready */
+    if (ata_wait_bsy(io_base + 7, ATA_PIO_TIMEOUT_MS) < 0) return -1;
+
+    ata_setup_lba(dev, lba, count, lba48);
+    outb(io_base + 7, lba48 ? ATA_CMD_WRITE_PIO_EXT : ATA_CMD_WRITE_PIO);
+
+    /* The first sector is requested without an interrupt */
+    if (ata_poll(io_base + 7) < 0) return -1;
+    if (ata_wait_drq(io_base + 7, ATA_PIO_TIMEOUT_MS) < 0) return -1;
+
+    /* Write sectors: the drive interrupts after taking each one */
+    const uint16_t* buf = (const uint16_t*)buffer;
+    for (uint32_t s = 0; s < count; s++) {
+        ch->irq_fired = 0;
+        for (int i = 0; i < 256; i++) {
+            outw(io_base, buf[s * 256 + i]);
+        }
+
+        if (ata_pio_wait(dev->channel, s + 1 < count) < 0) return -1;
+    }
+
+    /* Data may still sit in the drive's write cache until ata_flush() */
+    return 0;
+}
+
+/*
+ * Split a request into the largest commands the drive takes: 256 sectors
+ * with 28-bit LBA, 65535 with LBA48, and what one PRD table can describe
+ * for DMA. A chunk that DMA cannot move goes through PIO.
+ */
+static int ata_transfer(uint8_t drive, uint32_t lba, uint16_t count, void* buffer, int write) {
+    if (ata_ensure(drive) < 0) return -1;
     if (count == 0) return -1;
 
     ata_device_t* dev = &ata_devices[drive];
+    ata_async_complete(dev->channel);
+
+    uint32_t max = dev->lba48 ? ATA_MAX_SECTORS_LBA48 : ATA_MAX_SECTORS_LBA28;
+    if (dev->dma && max > ATA_DMA_MAX_SECTORS) max = ATA_DMA_MAX_SECTORS;
+
+    uint8_t* buf = (uint8_t*)buffer;
+    uint32_t left = count;
+
+    while (left > 0) {
+        uint16_t chunk = (uint16_t)(left > max ? max : left);
+        int done = 0;
+
+        if (dev->dma) {
+            /* Fall through to PIO if the buffer does not suit DMA or DMA failed (a timeout resets the channel first) */
+            done = ata_dma_transfer(dev, lba, chunk, buf, write) == 0;
+        }
+
+        if (!done) {
+            int rc = write ? ata_pio_write(dev, lba, chunk, buf)
+                           : ata_pio_read(dev, lba, chunk, buf);
+            if (rc < 0) return -1;
+        }
+
+        lba += chunk;
+        buf += (uint32_t)chunk * ATA_SECTOR_SIZE;
+        left -= chunk;
+    }
+
+    return 0;
+}
+
+int ata_read_sectors(uint8_t drive, uint32_t lba, uint16_t count, void* buffer) {
+    return ata_transfer(drive, lba, count, buffer, 0);
+}
+
+int ata_write_sectors(uint8_t drive, uint32_t lba, uint16_t count, const void* buffer) {
+    return ata_transfer(drive, lba, count, (void*)buffer, 1);
+}
+
+int ata_flush(uint8_t drive) {
+    if (ata_ensure(drive) < 0) return -1;
+
+    ata_device_t* dev = &ata_devices[drive];
+    ata_async_complete(dev->channel);
+
     uint16_t io_base = (dev->channel == 0) ? ATA_PRIMARY_DATA : ATA_SECONDARY_DATA;
     uint16_t ctrl_base = (dev->channel == 0) ? ATA_PRIMARY_CTRL : ATA_SECONDARY_CTRL;
 
-    /* Wait for drive to be ready */
-    if (ata_wait_bsy(io_base + 7) < 0) return -1;
+    if (ata_wait_bsy(io_base + 7, ATA_PIO_TIMEOUT_MS) < 0) return -1;
 
-    /* Select drive with LBA mode */
-    outb(io_base + 6, 0xE0 | (dev->drive << 4) | ((lba >> 24) & 0x0F));
+    outb(io_base + 6, 0xE0 | (dev->drive << 4));
     ata_io_wait(ctrl_base);
 
-    /* Send write command */
-    outb(io_base + 1, 0x00);                    /* Features */
-    outb(io_base + 2, count);                   /* Sector count */
-    outb(io_base + 3, (uint8_t)(lba & 0xFF));           /* LBA lo */
-    outb(io_base + 4, (uint8_t)((lba >> 8) & 0xFF));    /* LBA mid */
-    outb(io_base + 5, (uint8_t)((lba >> 16) & 0xFF));   /* LBA hi */
-    outb(io_base + 7, ATA_CMD_WRITE_PIO);       /* Command */
+    return ata_pio_command(dev->channel, dev->lba48 ? ATA_CMD_CACHE_FLUSH_EXT : ATA_CMD_CACHE_FLUSH);
+}
 
-    /* Write sectors */
-    const uint16_t* buf = (const uint16_t*)buffer;
-    for (int s = 0; s < count; s++) {
-        if (ata_poll(io_base + 7) < 0) return -1;
-        if (ata_wait_drq(io_base + 7) < 0) return -1;
+/*
+ * Asynchronous transfer: the command is started and the call returns
+ * while the drive works, so the other channel can be kept busy at the
+ * same time. A request that cannot go out as a single DMA command (no
+ * bus mastering, too long, unsuitable buffer) runs synchronously here
+ * and ata_finish_transfer() just reports its result.
+ */
+int ata_start_transfer(uint8_t drive, uint32_t lba, uint16_t count, void* buffer, int write) {
+    if (ata_ensure(drive) < 0) return -1;
+    if (count == 0) return -1;
 
-        for (int i = 0; i < 256; i++) {
-            outw(io_base, buf[s * 256 + i]);
-        }
+    ata_device_t* dev = &ata_devices[drive];
+    ata_channel_t* ch = &ata_channels[dev->channel];
 
-        /* Flush cache */
-        outb(io_base + 7, ATA_CMD_CACHE_FLUSH);
-        if (ata_poll(io_base + 7) < 0) return -1;
+    /* One started transfer per channel: an uncollected one is completed now */
+    ata_async_complete(dev->channel);
+    if (ch->async_drive == drive) return -1;
+    if (ch->async_drive != ATA_ASYNC_NONE) return 1;
+
+    int rc = 1;
+    if (dev->dma && count <= ATA_DMA_MAX_SECTORS) {
+        rc = ata_dma_start(dev, lba, count, buffer, write);
+    }
+    if (rc != 0) {
+        rc = ata_transfer(drive, lba, count, buffer, write);
+        ch->async_status = (int8_t)(rc < 0 ? -1 : 0);
+    } else {
+        ch->async_status = 1;
     }
 
+    ch->async_drive = drive;
     return 0;
 }
+
+int ata_finish_transfer(uint8_t drive) {
+    if (drive >= 4 || !ata_devices[drive].present) return -1;
+
+    uint8_t channel = ata_devices[drive].channel;
+    ata_channel_t* ch = &ata_channels[channel];
+    if (ch->async_drive != drive) return -1;
+
+    ata_async_complete(channel);
+    int rc = ch->async_status;
+    ch->async_drive = ATA_ASYNC_NONE;
+    return rc;
+}
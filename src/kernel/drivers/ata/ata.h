@@ -44,9 +44,41 @@
 #define ATA_CMD_WRITE_PIO       0x30
 #define ATA_CMD_WRITE_PIO_EXT   0x34
 #define ATA_CMD_CACHE_FLUSH     0xE7
+#define ATA_CMD_READ_DMA        0xC8
+#define ATA_CMD_READ_DMA_EXT    0x25
+#define ATA_CMD_WRITE_DMA       0xCA
+#define ATA_CMD_WRITE_DMA_EXT   0x35
 #define ATA_CMD_CACHE_FLUSH_EXT 0xEA
 #define ATA_CMD_IDENTIFY        0xEC
 
+/* PCI bus-master IDE registers (offsets from BAR4, +8 for secondary) */
+#define ATA_BM_COMMAND          0x00
+#define ATA_BM_STATUS           0x02
+#define ATA_BM_PRDT             0x04
+
+#define ATA_BM_CMD_START        0x01
+#define ATA_BM_CMD_READ         0x08    /* Device -> memory */
+
+#define ATA_BM_SR_ACTIVE        0x01
+#define ATA_BM_SR_ERR           0x02
+#define ATA_BM_SR_IRQ           0x04
+
+/* Physical Region Descriptor */
+typedef struct __attribute__((packed)) {
+    uint32_t    addr;
+    uint16_t    byte_count;     /* 0 means 64 KB */
+    uint16_t    flags;          /* Bit 15: end of table */
+} ata_prd_t;
+
+#define ATA_PRD_EOT             0x8000
+#define ATA_PRD_ENTRIES         16
+
+/* Sectors per command */
+#define ATA_MAX_SECTORS_LBA28   256
+#define ATA_MAX_SECTORS_LBA48   0xFFFF
+/* A buffer spans at most one more 64 KB window than its length needs */
+#define ATA_DMA_MAX_SECTORS     ((ATA_PRD_ENTRIES - 1) * 128)
+
 /* Drive selection */
 #define ATA_MASTER      0x00
 #define ATA_SLAVE       0x01
@@ -62,17 +94,35 @@ typedef struct {
     uint16_t    capabilities;
     uint32_t    command_sets;
     uint32_t    size;           /* Size in sectors */
+    uint8_t     lba48;          /* 48-bit LBA feature set supported */
+    uint8_t     dma;            /* Bus-master DMA usable */
     char        model[41];
 } ata_device_t;
 
-/* Initialize ATA subsystem, detect drives */
+/* Initialize ATA subsystem, detect drives (IDENTIFY runs on first use of each) */
 int ata_init(void);
 
+/* Drive answered the reset probe; unlike ata_drive_exists() this sends no command */
+int ata_drive_detected(uint8_t drive);
+
 /* Read sectors from drive */
-int ata_read_sectors(uint8_t drive, uint32_t lba, uint8_t count, void* buffer);
+int ata_read_sectors(uint8_t drive, uint32_t lba, uint16_t count, void* buffer);
 
 /* Write sectors to drive */
-int ata_write_sectors(uint8_t drive, uint32_t lba, uint8_t count, const void* buffer);
+int ata_write_sectors(uint8_t drive, uint32_t lba, uint16_t count, const void* buffer);
+
+/* Write barrier: commit the drive's volatile write cache to media */
+int ata_flush(uint8_t drive);
+
+/*
+ * Start a transfer without waiting for it; at most one per channel.
+ * The buffer must stay untouched until ata_finish_transfer() collects
+ * the result (0 or -1). Drives on different channels run concurrently.
+ * Returns 1 without starting anything while the other drive on the
+ * channel still has a transfer to collect.
+ */
+int ata_start_transfer(uint8_t drive, uint32_t lba, uint16_t count, void* buffer, int write);
+int ata_finish_transfer(uint8_t drive);
 
 /* Get drive info */
 ata_device_t* ata_get_device(uint8_t drive);
@@ -80,4 +130,7 @@ ata_device_t* ata_get_device(uint8_t drive);
 /* Check if drive exists */
 int ata_drive_exists(uint8_t drive);
 
+/* Channel interrupt (IRQ14 -> 0, IRQ15 -> 1), called from irq_handler */
+void ata_irq_handler(uint8_t channel);
+
 #endif
\ No newline at end of file
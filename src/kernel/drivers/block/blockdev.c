@@ -0,0 +1,312 @@
+#include "blockdev.h"
+#include "../ata/ata.h"
+#include "../virtio/virtio_blk.h"
+#include "../ahci/ahci.h"
+#include "../../utils/string.h"
+
+static blockdev_t blockdevs[BLOCKDEV_MAX];
+static uint8_t blockdev_ready = 0;
+
+/* ATA backend: the device id is the ATA drive number */
+
+static int ata_blk_read(blockdev_t* dev, uint32_t lba, uint16_t count, void* buffer) {
+    return ata_read_sectors(dev->id, lba, count, buffer);
+}
+
+static int ata_blk_write(blockdev_t* dev, uint32_t lba, uint16_t count, const void* buffer) {
+    return ata_write_sectors(dev->id, lba, count, buffer);
+}
+
+static int ata_blk_flush(blockdev_t* dev) {
+    return ata_flush(dev->id);
+}
+
+/* The two IDE channels work independently: a started request leaves its channel busy */
+static int ata_blk_start(blockdev_t* dev, blockdev_request_t* req) {
+    return ata_start_transfer(dev->id, req->lba, req->count, req->buffer, req->write);
+}
+
+static int ata_blk_finish(blockdev_t* dev, blockdev_request_t* req) {
+    (void)req;
+    return ata_finish_transfer(dev->id);
+}
+
+static const blockdev_ops_t ata_blk_ops = {
+    ata_blk_read,
+    ata_blk_write,
+    ata_blk_flush,
+    NULL,
+    ata_blk_start,
+    ata_blk_finish,
+};
+
+static const char* const ata_blk_names[BLOCKDEV_ATA_SLOTS] = { "hd0", "hd1", "hd2", "hd3" };
+
+/* ATA slots that answered the probe but are not registered yet, one bit per slot */
+static uint8_t ata_blk_pending = 0;
+
+/* Identify the drive on first lookup and register it under its ATA number */
+static void ata_blk_attach(uint8_t id) {
+    ata_blk_pending &= (uint8_t)~(1 << id);
+
+    ata_device_t* ata = ata_get_device(id);
+    if (!ata) return;
+    blockdev_add(id, ata_blk_names[id], ata->model, ata->size, 1, &ata_blk_ops, NULL);
+}
+
+void blockdev_init(void) {
+    if (blockdev_ready) return;
+    blockdev_ready = 1;
+
+    ata_init();
+    for (uint8_t i = 0; i < BLOCKDEV_ATA_SLOTS; i++) {
+        if (ata_drive_detected(i)) ata_blk_pending |= (uint8_t)(1 << i);
+    }
+
+    /* Paravirtual and SATA disks take the first ids after the ATA slots */
+    virtio_blk_init();
+    ahci_init();
+}
+
+int blockdev_add(int id, const char* name, const char* model, uint32_t sectors,
+                 uint16_t queue_depth, const blockdev_ops_t* ops, void* priv) {
+    blockdev_init();
+
+    if (id == BLOCKDEV_ANY) {
+        for (int i = BLOCKDEV_ATA_SLOTS; i < BLOCKDEV_MAX; i++) {
+            if (!blockdevs[i].present) {
+                id = i;
+                break;
+            }
+        }
+    }
+    if (id < 0 || id >= BLOCKDEV_MAX || blockdevs[id].present) return -1;
+    if (!ops || !ops->read || !ops->write) return -1;
+
+    blockdev_t* dev = &blockdevs[id];
+    memset(dev, 0, sizeof(blockdev_t));
+    dev->present = 1;
+    dev->id = (uint8_t)id;
+    strncpy(dev->name, name, sizeof(dev->name) - 1);
+    strncpy(dev->model, model, sizeof(dev->model) - 1);
+    dev->sectors = sectors;
+    dev->queue_depth = queue_depth ? queue_depth : 1;
+    dev->ops = ops;
+    dev->priv = priv;
+    return id;
+}
+
+blockdev_t* blockdev_get(uint8_t id) {
+    blockdev_init();
+    if (id < BLOCKDEV_ATA_SLOTS && (ata_blk_pending & (1 << id))) ata_blk_attach(id);
+    if (id >= BLOCKDEV_MAX || !blockdevs[id].present) return NULL;
+    return &blockdevs[id];
+}
+
+int blockdev_exists(uint8_t id) {
+    return blockdev_get(id) != NULL;
+}
+
+/* A device that reports no size is not range checked */
+static int blockdev_in_range(blockdev_t* dev, uint32_t lba, uint16_t count) {
+    if (count == 0) return 0;
+    if (dev->sectors == 0) return 1;
+    return lba < dev->sectors && count <= dev->sectors - lba;
+}
+
+int blockdev_read(uint8_t id, uint32_t lba, uint16_t count, void* buffer) {
+    blockdev_t* dev = blockdev_get(id);
+    if (!dev || !blockdev_in_range(dev, lba, count)) return -1;
+    return dev->ops->read(dev, lba, count, buffer);
+}
+
+int blockdev_write(uint8_t id, uint32_t lba, uint16_t count, const void* buffer) {
+    blockdev_t* dev = blockdev_get(id);
+    if (!dev || !blockdev_in_range(dev, lba, count)) return -1;
+    return dev->ops->write(dev, lba, count, buffer);
+}
+
+int blockdev_flush(uint8_t id) {
+    blockdev_t* dev = blockdev_get(id);
+    if (!dev) return -1;
+    if (!dev->ops->flush) return 0;
+    return dev->ops->flush(dev);
+}
+
+int blockdev_submit(uint8_t id, blockdev_request_t* reqs, uint32_t count) {
+    blockdev_t* dev = blockdev_get(id);
+    if (!dev) return -1;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (!blockdev_in_range(dev, reqs[i].lba, reqs[i].count)) {
+            reqs[i].status = -1;
+            return -1;
+        }
+    }
+
+    if (dev->ops->submit) return dev->ops->submit(dev, reqs, count);
+
+    int result = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        blockdev_request_t* r = &reqs[i];
+        if (r->write) r->status = dev->ops->write(dev, r->lba, r->count, r->buffer);
+        else r->status = dev->ops->read(dev, r->lba, r->count, r->buffer);
+        if (r->status < 0) result = -1;
+    }
+    return result;
+}
+
+/*
+ * Asynchronous single requests. Devices without start/finish, or busy
+ * with an earlier one, run the request right away and blockdev_finish()
+ * only reports its status.
+ */
+int blockdev_start(uint8_t id, blockdev_request_t* req) {
+    blockdev_t* dev = blockdev_get(id);
+    req->status = -1;
+    if (!dev || !blockdev_in_range(dev, req->lba, req->count)) return -1;
+
+    if (dev->ops->start) {
+        int rc = dev->ops->start(dev, req);
+        if (rc < 0) return -1;
+        if (rc == 0) {
+            req->status = 1;
+            return 0;
+        }
+    }
+
+    if (req->write) req->status = dev->ops->write(dev, req->lba, req->count, req->buffer);
+    else req->status = dev->ops->read(dev, req->lba, req->count, req->buffer);
+    return 0;
+}
+
+int blockdev_finish(uint8_t id, blockdev_request_t* req) {
+    blockdev_t* dev = blockdev_get(id);
+    if (!dev) return -1;
+
+    if (req->status == 1) {
+        req->status = dev->ops->finish(dev, req) < 0 ? -1 : 0;
+    }
+    return req->status;
+}
+
+/* Merged requests whose buffers are not contiguous are gathered here (64 KB) */
+#define BLOCKDEV_STAGE_SECTORS  128
+
+static uint8_t blockdev_stage[BLOCKDEV_STAGE_SECTORS * BLOCKDEV_SECTOR_SIZE] __attribute__((aligned(16)));
+
+void blockdev_queue_init(blockdev_queue_t* q, uint8_t id) {
+    q->id = id;
+    q->count = 0;
+    q->issued = 0;
+}
+
+int blockdev_queue_add(blockdev_queue_t* q, uint32_t lba, uint16_t count, uint8_t write, void* buffer) {
+    if (q->count >= BLOCKDEV_QUEUE_MAX || count == 0) return -1;
+
+    blockdev_request_t* r = &q->reqs[q->count];
+    r->lba = lba;
+    r->count = count;
+    r->write = write;
+    r->buffer = buffer;
+    r->status = -1;
+    return (int)q->count++;
+}
+
+int blockdev_queue_run(blockdev_queue_t* q) {
+    static uint16_t order[BLOCKDEV_QUEUE_MAX];
+    static blockdev_request_t merged[BLOCKDEV_QUEUE_MAX];
+    static uint16_t first_of[BLOCKDEV_QUEUE_MAX];
+    static uint16_t span_of[BLOCKDEV_QUEUE_MAX];
+    static uint8_t staged_of[BLOCKDEV_QUEUE_MAX];
+
+    uint32_t n = q->count;
+    q->count = 0;
+    q->issued = 0;
+    if (n == 0) return 0;
+
+    /* Elevator order: one ascending sweep over the LBAs */
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t j = i;
+        while (j > 0 && q->reqs[order[j - 1]].lba > q->reqs[i].lba) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = (uint16_t)i;
+    }
+
+    uint32_t m = 0;
+    uint32_t stage_used = 0;
+    uint32_t k = 0;
+    while (k < n) {
+        blockdev_request_t* head = &q->reqs[order[k]];
+        uint32_t sectors = head->count;
+        uint32_t span = 1;
+        int contiguous = 1;
+
+        /* Absorb the following requests while they continue this one on disk */
+        while (k + span < n) {
+            blockdev_request_t* prev = &q->reqs[order[k + span - 1]];
+            blockdev_request_t* next = &q->reqs[order[k + span]];
+            if (next->write != head->write) break;
+            if (next->lba != prev->lba + prev->count) break;
+            if (sectors + next->count > 0xFFFF) break;
+
+            int adjacent = (uint8_t*)next->buffer ==
+                           (uint8_t*)prev->buffer + (uint32_t)prev->count * BLOCKDEV_SECTOR_SIZE;
+            if (!(contiguous && adjacent) &&
+                stage_used + sectors + next->count > BLOCKDEV_STAGE_SECTORS) break;
+
+            contiguous = contiguous && adjacent;
+            sectors += next->count;
+            span++;
+        }
+
+        blockdev_request_t* out = &merged[m];
+        out->lba = head->lba;
+        out->count = (uint16_t)sectors;
+        out->write = head->write;
+        out->buffer = head->buffer;
+        out->status = -1;
+        staged_of[m] = 0;
+
+        if (!contiguous) {
+            /* Buffers are scattered in memory: go through the stage area */
+            uint8_t* stage = blockdev_stage + stage_used * BLOCKDEV_SECTOR_SIZE;
+            if (head->write) {
+                uint32_t offset = 0;
+                for (uint32_t s = 0; s < span; s++) {
+                    blockdev_request_t* r = &q->reqs[order[k + s]];
+                    memcpy(stage + offset, r->buffer, (uint32_t)r->count * BLOCKDEV_SECTOR_SIZE);
+                    offset += (uint32_t)r->count * BLOCKDEV_SECTOR_SIZE;
+                }
+            }
+            out->buffer = stage;
+            stage_used += sectors;
+            staged_of[m] = 1;
+        }
+
+        first_of[m] = (uint16_t)k;
+        span_of[m] = (uint16_t)span;
+        m++;
+        k += span;
+    }
+
+    int result = blockdev_submit(q->id, merged, m);
+    q->issued = m;
+
+    for (uint32_t i = 0; i < m; i++) {
+        uint32_t offset = 0;
+        for (uint32_t s = 0; s < span_of[i]; s++) {
+            blockdev_request_t* r = &q->reqs[order[first_of[i] + s]];
+            r->status = merged[i].status;
+            if (staged_of[i] && !r->write && merged[i].status == 0) {
+                memcpy(r->buffer, (uint8_t*)merged[i].buffer + offset,
+                       (uint32_t)r->count * BLOCKDEV_SECTOR_SIZE);
+            }
+            offset += (uint32_t)r->count * BLOCKDEV_SECTOR_SIZE;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,110 @@
+#ifndef BLOCKDEV_H
+#define BLOCKDEV_H
+
+#include <stdint.h>
+
+/*
+ * Block device layer. Filesystems and the block cache address devices by
+ * id; each backend (ATA, RAM disk, ...) registers its operations here.
+ * Ids 0-3 are the ATA drives in their usual order, so "drive 1" keeps
+ * meaning the primary slave. Other devices take the ids that follow.
+ */
+
+#define BLOCKDEV_MAX            8
+#define BLOCKDEV_ATA_SLOTS      4
+#define BLOCKDEV_ANY            (-1)
+
+#define BLOCKDEV_SECTOR_SIZE    512
+
+typedef struct blockdev blockdev_t;
+
+/* One transfer in a batch handed to blockdev_submit() */
+typedef struct {
+    uint32_t    lba;
+    uint16_t    count;
+    uint8_t     write;
+    void*       buffer;
+    int         status;         /* 0 or -1, filled in on completion */
+} blockdev_request_t;
+
+typedef struct {
+    int (*read)(blockdev_t* dev, uint32_t lba, uint16_t count, void* buffer);
+    int (*write)(blockdev_t* dev, uint32_t lba, uint16_t count, const void* buffer);
+
+    /* Commit volatile write cache; NULL if the device has none */
+    int (*flush)(blockdev_t* dev);
+
+    /* Run a batch, possibly several at once; NULL runs it request by request */
+    int (*submit)(blockdev_t* dev, blockdev_request_t* reqs, uint32_t count);
+
+    /*
+     * Start one request and return while it runs; finish() waits for it.
+     * start() returns 1 when the device cannot take the request now, and
+     * the request then runs synchronously. NULL if the device is synchronous
+     */
+    int (*start)(blockdev_t* dev, blockdev_request_t* req);
+    int (*finish)(blockdev_t* dev, blockdev_request_t* req);
+} blockdev_ops_t;
+
+struct blockdev {
+    uint8_t     present;
+    uint8_t     id;
+    char        name[8];
+    char        model[41];
+    uint32_t    sectors;
+    uint16_t    queue_depth;    /* Requests the device can have in flight */
+    const blockdev_ops_t* ops;
+    void*       priv;
+};
+
+/* Detect built-in devices (ATA, virtio-blk, AHCI); called lazily by the other functions */
+void blockdev_init(void);
+
+/* Register a device at `id` or, with BLOCKDEV_ANY, the first free id. Returns the id or -1 */
+int blockdev_add(int id, const char* name, const char* model, uint32_t sectors,
+                 uint16_t queue_depth, const blockdev_ops_t* ops, void* priv);
+
+blockdev_t* blockdev_get(uint8_t id);
+int blockdev_exists(uint8_t id);
+
+int blockdev_read(uint8_t id, uint32_t lba, uint16_t count, void* buffer);
+int blockdev_write(uint8_t id, uint32_t lba, uint16_t count, const void* buffer);
+int blockdev_flush(uint8_t id);
+
+/* Returns 0 if every request succeeded; per-request results are in status */
+int blockdev_submit(uint8_t id, blockdev_request_t* reqs, uint32_t count);
+
+/*
+ * Start a single request without waiting, then collect it with
+ * blockdev_finish() (returns 0 or -1). Requests on different devices, such
+ * as drives on the two IDE channels, proceed at the same time. The buffer
+ * belongs to the device until the request is finished.
+ */
+int blockdev_start(uint8_t id, blockdev_request_t* req);
+int blockdev_finish(uint8_t id, blockdev_request_t* req);
+
+/*
+ * Request queue for one device. Callers collect scattered transfers, then
+ * run them as one batch: the queue sorts them by LBA (a single elevator
+ * sweep), merges neighbours going the same way into one multi-sector
+ * command and waits once for the whole batch. Queued requests must not
+ * overlap each other, since their order is not kept.
+ */
+#define BLOCKDEV_QUEUE_MAX      128
+
+typedef struct {
+    uint8_t             id;
+    uint32_t            count;
+    uint32_t            issued;     /* Device commands sent by the last run */
+    blockdev_request_t  reqs[BLOCKDEV_QUEUE_MAX];
+} blockdev_queue_t;
+
+void blockdev_queue_init(blockdev_queue_t* q, uint8_t id);
+
+/* Returns the request's index in the queue, or -1 if the queue is full */
+int blockdev_queue_add(blockdev_queue_t* q, uint32_t lba, uint16_t count, uint8_t write, void* buffer);
+
+/* Issue and wait for everything queued; the queue is empty afterwards but statuses stay readable */
+int blockdev_queue_run(blockdev_queue_t* q);
+
+#endif
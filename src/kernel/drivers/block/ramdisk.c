@@ -0,0 +1,87 @@
+#include "ramdisk.h"
+#include "blockdev.h"
+#include "../../utils/string.h"
+
+typedef struct {
+    uint8_t*    chunks[RAMDISK_MAX_CHUNKS];
+    uint32_t    sectors;
+} ramdisk_t;
+
+static ramdisk_t ramdisks[RAMDISK_MAX];
+static int ramdisk_count = 0;
+
+/* Copies between a buffer and the disk, one chunk-sized piece at a time */
+static void ramdisk_copy(ramdisk_t* rd, uint32_t lba, uint16_t count, uint8_t* buffer, int write) {
+    uint32_t offset = lba * BLOCKDEV_SECTOR_SIZE;
+    uint32_t left = (uint32_t)count * BLOCKDEV_SECTOR_SIZE;
+
+    while (left > 0) {
+        uint32_t within = offset % RAMDISK_CHUNK_SIZE;
+        uint32_t n = RAMDISK_CHUNK_SIZE - within;
+        if (n > left) n = left;
+
+        uint8_t* data = rd->chunks[offset / RAMDISK_CHUNK_SIZE] + within;
+        if (write) memcpy(data, buffer, n);
+        else memcpy(buffer, data, n);
+
+        offset += n;
+        buffer += n;
+        left -= n;
+    }
+}
+
+static int ramdisk_read(blockdev_t* dev, uint32_t lba, uint16_t count, void* buffer) {
+    ramdisk_copy((ramdisk_t*)dev->priv, lba, count, (uint8_t*)buffer, 0);
+    return 0;
+}
+
+static int ramdisk_write(blockdev_t* dev, uint32_t lba, uint16_t count, const void* buffer) {
+    ramdisk_copy((ramdisk_t*)dev->priv, lba, count, (uint8_t*)buffer, 1);
+    return 0;
+}
+
+static const blockdev_ops_t ramdisk_ops = {
+    ramdisk_read,
+    ramdisk_write,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+};
+
+static const char* const ramdisk_names[RAMDISK_MAX] = { "ram0", "ram1", "ram2", "ram3" };
+
+static void ramdisk_release(ramdisk_t* rd, uint32_t chunks) {
+    for (uint32_t i = 0; i < chunks; i++) {
+        pmm_free_pages(rd->chunks[i]);
+        rd->chunks[i] = NULL;
+    }
+}
+
+int ramdisk_create(uint32_t sectors) {
+    if (sectors == 0 || ramdisk_count >= RAMDISK_MAX) return -1;
+    if (sectors > RAMDISK_MAX_CHUNKS * (RAMDISK_CHUNK_SIZE / BLOCKDEV_SECTOR_SIZE)) return -1;
+
+    ramdisk_t* rd = &ramdisks[ramdisk_count];
+    uint32_t chunks = (sectors * BLOCKDEV_SECTOR_SIZE + RAMDISK_CHUNK_SIZE - 1) / RAMDISK_CHUNK_SIZE;
+
+    for (uint32_t i = 0; i < chunks; i++) {
+        rd->chunks[i] = (uint8_t*)pmm_alloc_pages(RAMDISK_CHUNK_ORDER, PMM_OWNER_RAMDISK);
+        if (!rd->chunks[i]) {
+            ramdisk_release(rd, i);
+            return -1;
+        }
+        memset(rd->chunks[i], 0, RAMDISK_CHUNK_SIZE);
+    }
+    rd->sectors = sectors;
+
+    int id = blockdev_add(BLOCKDEV_ANY, ramdisk_names[ramdisk_count], "RAM disk",
+                          sectors, 1, &ramdisk_ops, rd);
+    if (id < 0) {
+        ramdisk_release(rd, chunks);
+        return -1;
+    }
+
+    ramdisk_count++;
+    return id;
+}
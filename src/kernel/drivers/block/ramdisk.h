@@ -0,0 +1,20 @@
+#ifndef RAMDISK_H
+#define RAMDISK_H
+
+#include <stdint.h>
+#include "../../mm/pmm.h"
+
+/*
+ * RAM-backed block devices. Storage comes from the page allocator in
+ * 1 MB chunks, so a disk does not need physically contiguous memory.
+ */
+#define RAMDISK_CHUNK_ORDER     8                           /* 256 pages */
+#define RAMDISK_CHUNK_SIZE      (PMM_PAGE_SIZE << RAMDISK_CHUNK_ORDER)
+#define RAMDISK_MAX_CHUNKS      256                         /* 256 MB per disk */
+
+#define RAMDISK_MAX         4
+
+/* Create a zero-filled RAM disk; returns its block device id or -1 */
+int ramdisk_create(uint32_t sectors);
+
+#endif
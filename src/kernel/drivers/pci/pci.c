@@ -28,6 +28,80 @@ uint16_t pci_config_read_word(uint8_t bus, uint8_t slot, uint8_t func, uint8_t o
     return (uint16_t)((inl(0xCFC) >> ((offset & 2) * 8)) & 0xFFFF);
 }
 
+// Чтение полного 32-битного регистра (нужно для BAR'ов)
+uint32_t pci_config_read_dword(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset) {
+    uint32_t address = (uint32_t)(((uint32_t)bus << 16) | ((uint32_t)slot << 11) |
+    ((uint32_t)func << 8) | (offset & 0xFC) | ((uint32_t)0x80000000));
+
+    outl(0xCF8, address);
+    return inl(0xCFC);
+}
+
+// Запись 16-битного слова (например, в регистр команд по смещению 0x04)
+void pci_config_write_word(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset, uint16_t value) {
+    uint32_t address = (uint32_t)(((uint32_t)bus << 16) | ((uint32_t)slot << 11) |
+    ((uint32_t)func << 8) | (offset & 0xFC) | ((uint32_t)0x80000000));
+
+    outl(0xCF8, address);
+    outw((uint16_t)(0xCFC + (offset & 2)), value);
+}
+
+// Ищет первое устройство с заданным классом/подклассом.
+// В отличие от pci_scan_bus, смотрит все функции: IDE в PIIX3/4 живет на функции 1.
+int pci_find_class(uint8_t class_code, uint8_t subclass, pci_location_t* out) {
+    for (uint16_t bus = 0; bus < 256; bus++) {
+        for (uint8_t slot = 0; slot < 32; slot++) {
+            if (pci_config_read_word(bus, slot, 0, 0) == 0xFFFF) continue;
+
+            // Бит 7 типа заголовка — многофункциональное устройство
+            uint8_t header_type = pci_config_read_word(bus, slot, 0, 0x0E) & 0xFF;
+            uint8_t funcs = (header_type & 0x80) ? 8 : 1;
+
+            for (uint8_t func = 0; func < funcs; func++) {
+                if (pci_config_read_word(bus, slot, func, 0) == 0xFFFF) continue;
+
+                // Смещение 0x0A: младший байт — подкласс, старший — класс
+                uint16_t cls = pci_config_read_word(bus, slot, func, 0x0A);
+                if ((cls >> 8) == class_code && (cls & 0xFF) == subclass) {
+                    out->bus = (uint8_t)bus;
+                    out->slot = slot;
+                    out->func = func;
+                    return 0;
+                }
+            }
+        }
+    }
+    return -1;
+}
+
+// Ищет index-е по счету устройство с заданными Vendor/Device ID (все функции всех слотов)
+int pci_find_device(uint16_t vendor_id, uint16_t device_id, uint8_t index, pci_location_t* out) {
+    for (uint16_t bus = 0; bus < 256; bus++) {
+        for (uint8_t slot = 0; slot < 32; slot++) {
+            if (pci_config_read_word(bus, slot, 0, 0) == 0xFFFF) continue;
+
+            uint8_t header_type = pci_config_read_word(bus, slot, 0, 0x0E) & 0xFF;
+            uint8_t funcs = (header_type & 0x80) ? 8 : 1;
+
+            for (uint8_t func = 0; func < funcs; func++) {
+                if (pci_config_read_word(bus, slot, func, 0) != vendor_id) continue;
+                if (pci_config_read_word(bus, slot, func, 2) != device_id) continue;
+
+                if (index > 0) {
+                    index--;
+                    continue;
+                }
+
+                out->bus = (uint8_t)bus;
+                out->slot = slot;
+                out->func = func;
+                return 0;
+            }
+        }
+    }
+    return -1;
+}
+
 // Простой сканер PCI, который выведет все найденные устройства
 void pci_scan_bus() {
     vga_print_color("Scanning PCI bus...\n", LIGHT_CYAN);
@@ -79,6 +153,11 @@ void pci_scan_bus() {
                 rtl8139_init(io_base, irq);
             }
 
+            // Диск virtio-blk (transitional) подключается как блочное устройство, см. "disks"
+            if (vendor_id == 0x1AF4 && device_id == 0x1001) {
+                vga_print_color("  <-- virtio-blk", LIGHT_CYAN);
+            }
+
             vga_putc('\n');
         }
     }
@@ -3,8 +3,19 @@
 
 #include <stdint.h>
 
+// Положение устройства на шине
+typedef struct {
+    uint8_t bus;
+    uint8_t slot;
+    uint8_t func;
+} pci_location_t;
+
 // Базовые функции PCI
 uint16_t pci_config_read_word(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset);
+uint32_t pci_config_read_dword(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset);
+void pci_config_write_word(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset, uint16_t value);
+int pci_find_class(uint8_t class_code, uint8_t subclass, pci_location_t* out);
+int pci_find_device(uint16_t vendor_id, uint16_t device_id, uint8_t index, pci_location_t* out);
 void pci_scan_bus();
 
 #endif
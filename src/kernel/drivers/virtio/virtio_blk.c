@@ -0,0 +1,372 @@
+#include "virtio_blk.h"
+#include "../block/blockdev.h"
+#include "../pci/pci.h"
+#include "../../arch/i686/idt/isr.h"
+#include "../../arch/i686/timer/timer.h"
+#include "../../utils/ports.h"
+#include "../../utils/string.h"
+
+#define VIRTIO_BLK_MAX_DEVICES  2
+
+/* A stuck request is abandoned after this long */
+#define VIRTIO_BLK_TIMEOUT_MS   5000
+
+#define VIRTQ_ALIGN_UP(x)       (((x) + VIRTQ_ALIGN - 1) & ~(VIRTQ_ALIGN - 1))
+/* Legacy layout: descriptors, avail ring, then the used ring on its own page */
+#define VIRTQ_USED_OFFSET(n)    VIRTQ_ALIGN_UP(16 * (n) + 6 + 2 * (n))
+#define VIRTQ_BYTES(n)          (VIRTQ_USED_OFFSET(n) + VIRTQ_ALIGN_UP(6 + 8 * (n)))
+
+typedef struct {
+    uint16_t            io_base;
+    uint8_t             irq;
+    uint16_t            qsize;
+    uint16_t            seg_max;
+    uint32_t            features;
+
+    uint8_t*            ring;
+    volatile virtq_desc_t*  desc;
+    volatile virtq_avail_t* avail;
+    volatile virtq_used_t*  used;
+
+    uint16_t            free_head;      /* Free descriptors are chained through next */
+    uint16_t            num_free;
+    uint16_t            last_used;
+
+    /* Per request, indexed by its head descriptor */
+    virtio_blk_req_hdr_t hdr[VIRTQ_MAX_SIZE];
+    volatile uint8_t    status[VIRTQ_MAX_SIZE];
+    uint32_t            first[VIRTQ_MAX_SIZE];  /* Batch entries this request carries */
+    uint16_t            count[VIRTQ_MAX_SIZE];
+    uint8_t             posted[VIRTQ_MAX_SIZE];     /* Chain still owned by the device */
+} virtio_blk_t;
+
+static virtio_blk_t virtio_blks[VIRTIO_BLK_MAX_DEVICES];
+static uint8_t virtio_ring_mem[VIRTIO_BLK_MAX_DEVICES][VIRTQ_BYTES(VIRTQ_MAX_SIZE)]
+    __attribute__((aligned(VIRTQ_ALIGN)));
+static int virtio_blk_count = 0;
+static uint8_t virtio_blk_probed = 0;
+
+static const char* const virtio_blk_names[VIRTIO_BLK_MAX_DEVICES] = { "vd0", "vd1" };
+
+static int virtio_interrupts_enabled(void) {
+    uint32_t flags;
+    __asm__ volatile ("pushfl; popl %0" : "=r"(flags));
+    return (flags & 0x200) != 0;
+}
+
+/* Reading ISR status acknowledges the interrupt; completions are taken from the used ring */
+static void virtio_blk_irq(void* ctx) {
+    virtio_blk_t* vb = (virtio_blk_t*)ctx;
+    inb(vb->io_base + VIRTIO_REG_ISR_STATUS);
+}
+
+static uint16_t virtio_blk_desc_alloc(virtio_blk_t* vb) {
+    uint16_t idx = vb->free_head;
+    vb->free_head = vb->desc[idx].next;
+    vb->num_free--;
+    return idx;
+}
+
+static void virtio_blk_chain_free(virtio_blk_t* vb, uint16_t head) {
+    uint16_t idx = head;
+    for (;;) {
+        uint16_t flags = vb->desc[idx].flags;
+        uint16_t next = vb->desc[idx].next;
+
+        vb->desc[idx].next = vb->free_head;
+        vb->free_head = idx;
+        vb->num_free++;
+
+        if (!(flags & VIRTQ_DESC_F_NEXT)) break;
+        idx = next;
+    }
+}
+
+/*
+ * Queue one device request: header, then a data segment for each of the
+ * `n` batch entries starting at `first` (they are LBA-contiguous), then
+ * the status byte. The avail index is published but the device is not
+ * notified yet.
+ */
+static void virtio_blk_post(virtio_blk_t* vb, uint32_t type, blockdev_request_t* reqs,
+                            uint32_t first, uint16_t n) {
+    uint16_t head = virtio_blk_desc_alloc(vb);
+
+    vb->hdr[head].type = type;
+    vb->hdr[head].reserved = 0;
+    vb->hdr[head].sector = n ? reqs[first].lba : 0;
+    vb->status[head] = 0xFF;
+    vb->first[head] = first;
+    vb->count[head] = n;
+    vb->posted[head] = 1;
+
+    vb->desc[head].addr = (uint32_t)(uintptr_t)&vb->hdr[head];
+    vb->desc[head].len = sizeof(virtio_blk_req_hdr_t);
+    vb->desc[head].flags = VIRTQ_DESC_F_NEXT;
+
+    uint16_t prev = head;
+    for (uint16_t k = 0; k < n; k++) {
+        blockdev_request_t* r = &reqs[first + k];
+        uint16_t d = virtio_blk_desc_alloc(vb);
+
+        vb->desc[d].addr = (uint32_t)(uintptr_t)r->buffer;
+        vb->desc[d].len = (uint32_t)r->count * BLOCKDEV_SECTOR_SIZE;
+        vb->desc[d].flags = VIRTQ_DESC_F_NEXT | (r->write ? 0 : VIRTQ_DESC_F_WRITE);
+        vb->desc[prev].next = d;
+        prev = d;
+    }
+
+    uint16_t s = virtio_blk_desc_alloc(vb);
+    vb->desc[s].addr = (uint32_t)(uintptr_t)&vb->status[head];
+    vb->desc[s].len = 1;
+    vb->desc[s].flags = VIRTQ_DESC_F_WRITE;
+    vb->desc[prev].next = s;
+
+    vb->avail->ring[vb->avail->idx % vb->qsize] = head;
+
+    /* Descriptors must be visible before the index that publishes them */
+    __asm__ volatile ("" ::: "memory");
+    vb->avail->idx++;
+}
+
+/* Empty ring with every descriptor free; the device is told where it lives */
+static void virtio_blk_ring_reset(virtio_blk_t* vb) {
+    memset(vb->ring, 0, VIRTQ_BYTES(VIRTQ_MAX_SIZE));
+    memset(vb->posted, 0, sizeof(vb->posted));
+
+    for (uint16_t i = 0; i < vb->qsize; i++) {
+        vb->desc[i].next = (uint16_t)(i + 1);
+    }
+    vb->free_head = 0;
+    vb->num_free = vb->qsize;
+    vb->last_used = 0;
+
+    outw(vb->io_base + VIRTIO_REG_QUEUE_SELECT, 0);
+    outl(vb->io_base + VIRTIO_REG_QUEUE_PFN, (uint32_t)(uintptr_t)vb->ring / VIRTQ_ALIGN);
+}
+
+/*
+ * A request that did not come back may still be carried out later: the
+ * device would write into a buffer the caller has reused and post a used
+ * entry that a later call takes for its own. Resetting the device makes it
+ * drop the queue; what was in flight fails and the ring starts over.
+ */
+static void virtio_blk_recover(virtio_blk_t* vb, blockdev_request_t* reqs) {
+    uint16_t io = vb->io_base;
+    outb(io + VIRTIO_REG_DEVICE_STATUS, 0);
+
+    for (uint16_t head = 0; head < vb->qsize; head++) {
+        if (!vb->posted[head]) continue;
+        for (uint16_t k = 0; k < vb->count[head]; k++) {
+            reqs[vb->first[head] + k].status = -1;
+        }
+    }
+
+    outb(io + VIRTIO_REG_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE);
+    outb(io + VIRTIO_REG_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+    outl(io + VIRTIO_REG_GUEST_FEATURES, vb->features);
+    virtio_blk_ring_reset(vb);
+    outb(io + VIRTIO_REG_DEVICE_STATUS,
+         VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK);
+}
+
+/* Sleep until `pending` requests come back, then report each batch entry */
+static int virtio_blk_complete(virtio_blk_t* vb, blockdev_request_t* reqs, uint16_t pending) {
+    uint32_t freq = get_timer_frequency();
+    uint32_t start = get_ticks();
+    uint32_t limit = (VIRTIO_BLK_TIMEOUT_MS * freq) / 1000 + 1;
+    int sleep = virtio_interrupts_enabled() && freq != 0 && vb->irq != 0;
+    uint32_t spins = 0;
+    int result = 0;
+
+    while (pending > 0) {
+        __asm__ volatile ("" ::: "memory");
+
+        if (vb->last_used == vb->used->idx) {
+            if (sleep) {
+                /* cli/sti+hlt closes the window between the check and the halt */
+                __asm__ volatile ("cli");
+                if (vb->last_used == vb->used->idx) {
+                    if (get_ticks() - start > limit) {
+                        __asm__ volatile ("sti");
+                        virtio_blk_recover(vb, reqs);
+                        return -1;
+                    }
+                    __asm__ volatile ("sti; hlt");
+                } else {
+                    __asm__ volatile ("sti");
+                }
+            } else if (++spins > 100000000) {
+                virtio_blk_recover(vb, reqs);
+                return -1;
+            }
+            continue;
+        }
+
+        volatile virtq_used_elem_t* e = &vb->used->ring[vb->last_used % vb->qsize];
+        uint16_t head = (uint16_t)e->id;
+        int ok = vb->status[head] == VIRTIO_BLK_S_OK;
+
+        for (uint16_t k = 0; k < vb->count[head]; k++) {
+            reqs[vb->first[head] + k].status = ok ? 0 : -1;
+        }
+        if (!ok) result = -1;
+
+        vb->posted[head] = 0;
+        virtio_blk_chain_free(vb, head);
+        vb->last_used++;
+        pending--;
+    }
+
+    return result;
+}
+
+/*
+ * Fill the ring with as much of the batch as fits, kick the device once
+ * and wait. Runs of LBA-contiguous entries in the same direction become
+ * one multi-segment request.
+ */
+static int virtio_blk_submit(blockdev_t* dev, blockdev_request_t* reqs, uint32_t count) {
+    virtio_blk_t* vb = (virtio_blk_t*)dev->priv;
+    int result = 0;
+    uint32_t i = 0;
+
+    while (i < count) {
+        uint16_t posted = 0;
+
+        while (i < count) {
+            if (reqs[i].write && (vb->features & VIRTIO_BLK_F_RO)) {
+                reqs[i].status = -1;
+                result = -1;
+                i++;
+                continue;
+            }
+
+            uint32_t j = i + 1;
+            while (j < count && j - i < vb->seg_max &&
+                   reqs[j].write == reqs[i].write &&
+                   reqs[j].lba == reqs[j - 1].lba + reqs[j - 1].count) {
+                j++;
+            }
+            if (vb->num_free < (j - i) + 2) break;
+
+            virtio_blk_post(vb, reqs[i].write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN,
+                            reqs, i, (uint16_t)(j - i));
+            posted++;
+            i = j;
+        }
+
+        if (posted == 0) break;
+
+        outw(vb->io_base + VIRTIO_REG_QUEUE_NOTIFY, 0);
+        if (virtio_blk_complete(vb, reqs, posted) < 0) result = -1;
+    }
+
+    return result;
+}
+
+static int virtio_blk_read(blockdev_t* dev, uint32_t lba, uint16_t count, void* buffer) {
+    blockdev_request_t req = { lba, count, 0, buffer, 0 };
+    return virtio_blk_submit(dev, &req, 1);
+}
+
+static int virtio_blk_write(blockdev_t* dev, uint32_t lba, uint16_t count, const void* buffer) {
+    blockdev_request_t req = { lba, count, 1, (void*)buffer, 0 };
+    return virtio_blk_submit(dev, &req, 1);
+}
+
+static int virtio_blk_flush(blockdev_t* dev) {
+    virtio_blk_t* vb = (virtio_blk_t*)dev->priv;
+    if (!(vb->features & VIRTIO_BLK_F_FLUSH)) return 0;
+
+    virtio_blk_post(vb, VIRTIO_BLK_T_FLUSH, NULL, 0, 0);
+    outw(vb->io_base + VIRTIO_REG_QUEUE_NOTIFY, 0);
+    return virtio_blk_complete(vb, NULL, 1);
+}
+
+static const blockdev_ops_t virtio_blk_ops = {
+    virtio_blk_read,
+    virtio_blk_write,
+    virtio_blk_flush,
+    virtio_blk_submit,
+    NULL,
+    NULL,
+};
+
+static int virtio_blk_setup(pci_location_t* loc, virtio_blk_t* vb, uint8_t* ring) {
+    uint32_t bar0 = pci_config_read_dword(loc->bus, loc->slot, loc->func, 0x10);
+    if (!(bar0 & 1)) return -1;     /* Legacy registers live in I/O space */
+
+    /* Enable I/O decoding and bus mastering */
+    uint16_t cmd = pci_config_read_word(loc->bus, loc->slot, loc->func, 0x04);
+    pci_config_write_word(loc->bus, loc->slot, loc->func, 0x04, cmd | 0x05);
+
+    uint16_t io = (uint16_t)(bar0 & 0xFFFC);
+    vb->io_base = io;
+    vb->irq = (uint8_t)(pci_config_read_word(loc->bus, loc->slot, loc->func, 0x3C) & 0xFF);
+    if (vb->irq >= 16) vb->irq = 0;
+
+    outb(io + VIRTIO_REG_DEVICE_STATUS, 0);     /* Reset */
+    outb(io + VIRTIO_REG_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE);
+    outb(io + VIRTIO_REG_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+
+    uint32_t offered = inl(io + VIRTIO_REG_DEVICE_FEATURES);
+    vb->features = offered & (VIRTIO_BLK_F_SEG_MAX | VIRTIO_BLK_F_RO | VIRTIO_BLK_F_FLUSH);
+    outl(io + VIRTIO_REG_GUEST_FEATURES, vb->features);
+
+    outw(io + VIRTIO_REG_QUEUE_SELECT, 0);
+    uint16_t qsize = inw(io + VIRTIO_REG_QUEUE_SIZE);
+    if (qsize < 3 || qsize > VIRTQ_MAX_SIZE) {
+        /* A legacy device dictates its ring size; ours must have room for it */
+        outb(io + VIRTIO_REG_DEVICE_STATUS, VIRTIO_STATUS_FAILED);
+        return -1;
+    }
+
+    vb->qsize = qsize;
+    vb->ring = ring;
+    vb->desc = (volatile virtq_desc_t*)ring;
+    vb->avail = (volatile virtq_avail_t*)(ring + 16 * qsize);
+    vb->used = (volatile virtq_used_t*)(ring + VIRTQ_USED_OFFSET(qsize));
+
+    vb->seg_max = VIRTIO_BLK_MAX_SEGS;
+    if (vb->features & VIRTIO_BLK_F_SEG_MAX) {
+        uint32_t seg_max = inl(io + VIRTIO_REG_CONFIG + VIRTIO_BLK_CFG_SEG_MAX);
+        if (seg_max > 0 && seg_max < vb->seg_max) vb->seg_max = (uint16_t)seg_max;
+    }
+    if (vb->seg_max > qsize - 2) vb->seg_max = qsize - 2;
+
+    virtio_blk_ring_reset(vb);
+
+    /* Without a handler the line is left masked and requests are polled */
+    if (vb->irq && irq_register_handler(vb->irq, virtio_blk_irq, vb) < 0) vb->irq = 0;
+
+    outb(io + VIRTIO_REG_DEVICE_STATUS,
+         VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK);
+    return 0;
+}
+
+int virtio_blk_init(void) {
+    pci_location_t loc;
+
+    if (virtio_blk_probed) return virtio_blk_count;
+    virtio_blk_probed = 1;
+
+    for (uint8_t n = 0; virtio_blk_count < VIRTIO_BLK_MAX_DEVICES; n++) {
+        if (pci_find_device(VIRTIO_VENDOR_ID, VIRTIO_BLK_DEVICE_ID, n, &loc) < 0) break;
+
+        virtio_blk_t* vb = &virtio_blks[virtio_blk_count];
+        if (virtio_blk_setup(&loc, vb, virtio_ring_mem[virtio_blk_count]) < 0) continue;
+
+        uint16_t io = vb->io_base;
+        uint32_t cap_lo = inl(io + VIRTIO_REG_CONFIG + VIRTIO_BLK_CFG_CAPACITY);
+        uint32_t cap_hi = inl(io + VIRTIO_REG_CONFIG + VIRTIO_BLK_CFG_CAPACITY + 4);
+        uint32_t sectors = cap_hi ? 0xFFFFFFFF : cap_lo;
+
+        /* Every request takes a header, a data and a status descriptor */
+        blockdev_add(BLOCKDEV_ANY, virtio_blk_names[virtio_blk_count], "virtio-blk",
+                     sectors, vb->qsize / 3, &virtio_blk_ops, vb);
+        virtio_blk_count++;
+    }
+
+    return virtio_blk_count;
+}
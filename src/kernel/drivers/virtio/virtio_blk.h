@@ -0,0 +1,83 @@
+#ifndef VIRTIO_BLK_H
+#define VIRTIO_BLK_H
+
+#include <stdint.h>
+
+/* Transitional virtio-blk: legacy interface through I/O BAR0 */
+#define VIRTIO_VENDOR_ID            0x1AF4
+#define VIRTIO_BLK_DEVICE_ID        0x1001
+
+/* Legacy PCI register block */
+#define VIRTIO_REG_DEVICE_FEATURES  0x00
+#define VIRTIO_REG_GUEST_FEATURES   0x04
+#define VIRTIO_REG_QUEUE_PFN        0x08
+#define VIRTIO_REG_QUEUE_SIZE       0x0C
+#define VIRTIO_REG_QUEUE_SELECT     0x0E
+#define VIRTIO_REG_QUEUE_NOTIFY     0x10
+#define VIRTIO_REG_DEVICE_STATUS    0x12
+#define VIRTIO_REG_ISR_STATUS       0x13
+#define VIRTIO_REG_CONFIG           0x14    /* Device config without MSI-X */
+
+#define VIRTIO_STATUS_ACKNOWLEDGE   0x01
+#define VIRTIO_STATUS_DRIVER        0x02
+#define VIRTIO_STATUS_DRIVER_OK     0x04
+#define VIRTIO_STATUS_FAILED        0x80
+
+/* Block device config (offsets from VIRTIO_REG_CONFIG) */
+#define VIRTIO_BLK_CFG_CAPACITY     0x00    /* 64-bit, in 512-byte sectors */
+#define VIRTIO_BLK_CFG_SEG_MAX      0x0C
+
+#define VIRTIO_BLK_F_SEG_MAX        (1 << 2)
+#define VIRTIO_BLK_F_RO             (1 << 5)
+#define VIRTIO_BLK_F_FLUSH          (1 << 9)
+
+#define VIRTIO_BLK_T_IN             0
+#define VIRTIO_BLK_T_OUT            1
+#define VIRTIO_BLK_T_FLUSH          4
+
+#define VIRTIO_BLK_S_OK             0
+
+/* Split virtqueue */
+#define VIRTQ_DESC_F_NEXT           1
+#define VIRTQ_DESC_F_WRITE          2       /* Device writes this buffer */
+
+#define VIRTQ_ALIGN                 4096
+#define VIRTQ_MAX_SIZE              256     /* Largest ring the driver has room for */
+
+typedef struct __attribute__((packed)) {
+    uint64_t    addr;
+    uint32_t    len;
+    uint16_t    flags;
+    uint16_t    next;
+} virtq_desc_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t    flags;
+    uint16_t    idx;
+    uint16_t    ring[];
+} virtq_avail_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t    id;
+    uint32_t    len;
+} virtq_used_elem_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t    flags;
+    uint16_t    idx;
+    virtq_used_elem_t ring[];
+} virtq_used_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t    type;
+    uint32_t    reserved;
+    uint64_t    sector;
+} virtio_blk_req_hdr_t;
+
+/* Data descriptors one request may chain (adjacent batch entries are merged) */
+#define VIRTIO_BLK_MAX_SEGS         16
+
+/* Probe the PCI bus and register every virtio-blk disk as a block device */
+int virtio_blk_init(void);
+
+#endif
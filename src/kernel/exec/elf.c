@@ -1,4 +1,7 @@
 #include "elf.h"
+#include "heap.h"
+#include "../mm/pmm.h"
+#include "../arch/i686/paging/paging.h"
 #include "../fs/fat/fat.h"
 #include "../drivers/vga/vga.h"
 #include "../drivers/keyboard/keyboard.h"
@@ -6,16 +9,85 @@
 #include "../drivers/vga/colors.h"
 
 
-#define ELF_MAX_FILE_SIZE   (512 * 1024)
+#define ELF_HEAD_SIZE       4096    /* ELF and program headers are read up front */
+#define ELF_MAX_SEGMENTS    16
+
+/*
+ * The running program. Its file stays open (which also keeps it from being
+ * removed or truncated) while it runs; PT_LOAD pages are unmapped at start
+ * and filled from the file on first touch, BSS pages are zero-filled.
+ */
+typedef struct {
+    int         fd;
+    uint32_t    start;          /* Page-aligned span of all PT_LOAD segments */
+    uint32_t    end;
+    uint16_t    count;
+    Elf32_Phdr  segs[ELF_MAX_SEGMENTS];
+} elf_image_t;
+
+static elf_image_t image = { .fd = -1 };
+static uint8_t elf_head[ELF_HEAD_SIZE];
+
+static int page_in_image(uint32_t page) {
+    for (uint16_t i = 0; i < image.count; i++) {
+        const Elf32_Phdr* s = &image.segs[i];
+        if (page < s->p_vaddr + s->p_memsz && page + PAGE_SIZE > s->p_vaddr) return 1;
+    }
+    return 0;
+}
 
-static uint8_t elf_buffer[ELF_MAX_FILE_SIZE];
+static int fill_page(uint32_t page) {
+    memset((void*)page, 0, PAGE_SIZE);
 
-#define KERNEL_RESERVED_END 0x110000
-#define SAFE_LOAD_MAX       0xA00000
+    for (uint16_t i = 0; i < image.count; i++) {
+        const Elf32_Phdr* s = &image.segs[i];
+        uint32_t lo = page > s->p_vaddr ? page : s->p_vaddr;
+        uint32_t hi = page + PAGE_SIZE;
+        if (hi > s->p_vaddr + s->p_filesz) hi = s->p_vaddr + s->p_filesz;
+        if (lo >= hi) continue;
 
-#define HEAP_SIZE           0x100000
-static uint8_t program_heap[HEAP_SIZE];
-static uint32_t heap_offset = 0;
+        int got = fat_pread(image.fd, (void*)lo, hi - lo, s->p_offset + (lo - s->p_vaddr));
+        if (got != (int)(hi - lo)) return -1;
+    }
+    return 0;
+}
+
+/*
+ * Every page gets back its own identity frame, BSS included: drivers pass
+ * buffer addresses to DMA as physical, so an alias (such as a shared zero
+ * page) would send disk data to the wrong frame.
+ */
+static int elf_page_fault(uint32_t addr, uint32_t err, void* ctx) {
+    (void)ctx;
+    uint32_t page = addr & ~(PAGE_SIZE - 1);
+    if ((err & PF_PROTECTION) || !page_in_image(page)) return -1;
+
+    if (paging_map_page(page, page, PAGE_PRESENT | PAGE_WRITE) < 0) return -1;
+    return fill_page(page);
+}
+
+/*
+ * Faults taken inside the FAT driver must not re-enter it, so syscalls
+ * that hand program memory to the file system touch it first.
+ */
+static void touch_range(const void* ptr, uint32_t size) {
+    if (image.fd < 0 || size == 0) return;
+
+    uint32_t first = (uint32_t)ptr & ~(PAGE_SIZE - 1);
+    uint32_t last = (uint32_t)ptr + size - 1;
+    if (last < first) last = 0xFFFFFFFF;
+    if (first < image.start) first = image.start;
+    if (last >= image.end) last = image.end - 1;
+
+    for (uint32_t page = first; page <= last; page += PAGE_SIZE) {
+        if (page_in_image(page)) (void)*(volatile const uint8_t*)page;
+    }
+}
+
+static void touch_string(const char* str) {
+    if (image.fd < 0 || !str) return;
+    while (*(volatile const char*)str) str++;
+}
 
 static void sys_print(const char* str) {
     vga_print(str);
@@ -55,32 +127,41 @@ static uint32_t sys_get_ticks(void) {
 }
 
 static int sys_file_exists(const char* path) {
+    touch_string(path);
     return fat_exists(path);
 }
 
 static int sys_file_read(const char* path, void* buf, uint32_t max_size) {
+    touch_string(path);
+    touch_range(buf, max_size);
     return fat_read(path, buf, max_size);
 }
 
 static int sys_file_write(const char* path, const void* data, uint32_t size) {
+    touch_string(path);
+    touch_range(data, size);
     return fat_write(path, data, size);
 }
 
 static int sys_file_remove(const char* path) {
+    touch_string(path);
     return fat_rm(path);
 }
 
 static int sys_file_mkdir(const char* path) {
+    touch_string(path);
     return fat_mkdir(path);
 }
 
 static int sys_is_dir(const char* path) {
+    touch_string(path);
     return fat_is_dir(path);
 }
 
 static int sys_list_dir(const char* path, void (*callback)(const char* name, uint32_t size, uint8_t is_dir)) {
     (void)callback;
     if (!fat_is_mounted()) return -1;
+    touch_string(path);
     fat_ls(path);
     return 0;
 }
@@ -118,22 +199,30 @@ static int sys_get_key_nonblock(void) {
 }
 
 static void* sys_malloc(uint32_t size) {
-    size = (size + 3) & ~3;
-    if (heap_offset + size > HEAP_SIZE) return (void*)0;
-    void* ptr = &program_heap[heap_offset];
-    heap_offset += size;
-    return ptr;
+    return heap_malloc(size);
 }
 
 static void sys_free(void* ptr) {
-    (void)ptr;
+    heap_free(ptr);
+}
+
+static void* sys_realloc(void* ptr, uint32_t size) {
+    return heap_realloc(ptr, size);
+}
+
+static void* sys_calloc(uint32_t count, uint32_t size) {
+    return heap_calloc(count, size);
+}
+
+static void sys_heap_stats(program_heap_stats_t* stats) {
+    heap_get_stats(stats);
 }
 
 static void setup_syscall_table(void) {
     syscall_table_t* table = (syscall_table_t*)SYSCALL_TABLE_ADDR;
 
     table->magic = SYSCALL_MAGIC_VALUE;
-    table->version = 3;
+    table->version = 4;
 
     table->print = sys_print;
     table->print_color = sys_print_color;
@@ -162,6 +251,10 @@ static void setup_syscall_table(void) {
 
     table->malloc = sys_malloc;
     table->free = sys_free;
+
+    table->realloc = sys_realloc;
+    table->calloc = sys_calloc;
+    table->heap_stats = sys_heap_stats;
 }
 
 elf_error_t elf_validate(const void* data, uint32_t size) {
@@ -198,6 +291,12 @@ elf_error_t elf_validate(const void* data, uint32_t size) {
         return ELF_ERR_NO_SEGMENTS;
     }
 
+    /* Program headers must lie within the data (for files: within the first ELF_HEAD_SIZE bytes) */
+    if (ehdr->e_phentsize != sizeof(Elf32_Phdr) || ehdr->e_phoff > size ||
+        ehdr->e_phnum > (size - ehdr->e_phoff) / sizeof(Elf32_Phdr)) {
+        return ELF_ERR_NOT_ELF;
+    }
+
     return ELF_OK;
 }
 
@@ -232,47 +331,109 @@ elf_error_t elf_get_info(const void* data, uint32_t size, elf_info_t* info) {
     return ELF_OK;
 }
 
-elf_error_t elf_load(const void* data, uint32_t size, uint32_t* entry) {
-    elf_error_t err = elf_validate(data, size);
-    if (err != ELF_OK) return err;
+/* The kernel image (and the page allocator's frame map) may extend past KERNEL_RESERVED_END */
+static uint32_t load_window_start(void) {
+    pmm_stats_t st;
+    pmm_get_stats(&st);
+    return st.kernel_end > KERNEL_RESERVED_END ? st.kernel_end : KERNEL_RESERVED_END;
+}
 
-    const Elf32_Ehdr* ehdr = (const Elf32_Ehdr*)data;
-    const Elf32_Phdr* phdr = (const Elf32_Phdr*)((uint8_t*)data + ehdr->e_phoff);
+/* PT_LOAD segments must fit the load window and take their data from inside the file */
+static elf_error_t check_segments(const Elf32_Ehdr* ehdr, const Elf32_Phdr* phdr, uint32_t file_size) {
+    uint32_t window_start = load_window_start();
 
     for (uint16_t i = 0; i < ehdr->e_phnum; i++) {
         if (phdr[i].p_type != PT_LOAD) continue;
         if (phdr[i].p_memsz == 0) continue;
 
         uint32_t vaddr = phdr[i].p_vaddr;
-        uint32_t memsz = phdr[i].p_memsz;
-        uint32_t end_addr = vaddr + memsz;
+        uint32_t end_addr = vaddr + phdr[i].p_memsz;
+        uint32_t file_end = phdr[i].p_offset + phdr[i].p_filesz;
 
-        if (vaddr < KERNEL_RESERVED_END || end_addr > SAFE_LOAD_MAX) {
+        if (vaddr < window_start || end_addr < vaddr || end_addr > SAFE_LOAD_MAX) {
+            return ELF_ERR_LOAD_FAILED;
+        }
+        if (phdr[i].p_filesz > phdr[i].p_memsz || file_end < phdr[i].p_offset || file_end > file_size) {
             return ELF_ERR_LOAD_FAILED;
         }
     }
+    return ELF_OK;
+}
+
+elf_error_t elf_load(const void* data, uint32_t size, uint32_t* entry) {
+    elf_error_t err = elf_validate(data, size);
+    if (err != ELF_OK) return err;
+
+    const Elf32_Ehdr* ehdr = (const Elf32_Ehdr*)data;
+    const Elf32_Phdr* phdr = (const Elf32_Phdr*)((uint8_t*)data + ehdr->e_phoff);
+
+    err = check_segments(ehdr, phdr, size);
+    if (err != ELF_OK) return err;
 
     for (uint16_t i = 0; i < ehdr->e_phnum; i++) {
         if (phdr[i].p_type != PT_LOAD) continue;
+        if (phdr[i].p_memsz == 0) continue;
 
-        uint32_t vaddr = phdr[i].p_vaddr;
-        uint32_t filesz = phdr[i].p_filesz;
-        uint32_t memsz = phdr[i].p_memsz;
-        uint32_t offset = phdr[i].p_offset;
+        uint8_t* dest = (uint8_t*)phdr[i].p_vaddr;
+        memcpy(dest, (const uint8_t*)data + phdr[i].p_offset, phdr[i].p_filesz);
+        memset(dest + phdr[i].p_filesz, 0, phdr[i].p_memsz - phdr[i].p_filesz);
+    }
+
+    *entry = ehdr->e_entry;
+    return ELF_OK;
+}
 
-        if (offset + filesz > size) {
+/* Restores the identity mapping of the program window */
+static void unmap_image(void) {
+    for (uint32_t page = image.start; page < image.end; page += PAGE_SIZE) {
+        if (page_in_image(page)) paging_map_page(page, page, PAGE_PRESENT | PAGE_WRITE);
+    }
+    paging_unregister_fault_handler(elf_page_fault, &image);
+
+    image.fd = -1;
+    image.count = 0;
+    image.start = image.end = 0;
+}
+
+/* Sets up lazy loading from fd; elf_head holds the file's headers */
+static elf_error_t map_image(int fd, uint32_t file_size, uint32_t* entry) {
+    const Elf32_Ehdr* ehdr = (const Elf32_Ehdr*)elf_head;
+    const Elf32_Phdr* phdr = (const Elf32_Phdr*)(elf_head + ehdr->e_phoff);
+
+    elf_error_t err = check_segments(ehdr, phdr, file_size);
+    if (err != ELF_OK) return err;
+
+    image.count = 0;
+    image.start = 0xFFFFFFFF;
+    image.end = 0;
+
+    for (uint16_t i = 0; i < ehdr->e_phnum; i++) {
+        if (phdr[i].p_type != PT_LOAD) continue;
+        if (phdr[i].p_memsz == 0) continue;
+        if (image.count == ELF_MAX_SEGMENTS) {
+            image.count = 0;
             return ELF_ERR_LOAD_FAILED;
         }
 
-        uint8_t* dest = (uint8_t*)vaddr;
-        const uint8_t* src = (const uint8_t*)data + offset;
+        uint32_t first = phdr[i].p_vaddr & ~(PAGE_SIZE - 1);
+        uint32_t last = (phdr[i].p_vaddr + phdr[i].p_memsz + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+        if (first < image.start) image.start = first;
+        if (last > image.end) image.end = last;
 
-        for (uint32_t j = 0; j < filesz; j++) {
-            dest[j] = src[j];
-        }
+        image.segs[image.count++] = phdr[i];
+    }
+    if (image.count == 0) return ELF_ERR_NO_SEGMENTS;
 
-        for (uint32_t j = filesz; j < memsz; j++) {
-            dest[j] = 0;
+    if (paging_register_fault_handler(image.start, image.end, elf_page_fault, &image) < 0) {
+        image.count = 0;
+        return ELF_ERR_NO_MEMORY;
+    }
+    image.fd = fd;
+
+    for (uint32_t page = image.start; page < image.end; page += PAGE_SIZE) {
+        if (page_in_image(page) && paging_unmap_page(page) < 0) {
+            unmap_image();
+            return ELF_ERR_NO_MEMORY;
         }
     }
 
@@ -288,33 +449,37 @@ int elf_exec(const char* path) {
         return -1;
     }
 
-    int bytes_read = fat_read(path, elf_buffer, ELF_MAX_FILE_SIZE);
-    if (bytes_read < 0) {
+    int fd = fat_open(path, FAT_O_READ);
+    if (fd < 0) {
         vga_print_color("Error: File not found: ", LIGHT_RED);
         vga_print_color(path, LIGHT_RED);
         vga_putc('\n');
         return -1;
     }
 
-    if (bytes_read < (int)sizeof(Elf32_Ehdr)) {
+    /* Only the headers are read now; segment pages come in as they are touched */
+    int head_size = fat_pread(fd, elf_head, ELF_HEAD_SIZE, 0);
+    if (head_size < (int)sizeof(Elf32_Ehdr)) {
         vga_print_color("Error: File too small\n", LIGHT_RED);
+        fat_close(fd);
         return -1;
     }
 
-    elf_error_t err = elf_validate(elf_buffer, bytes_read);
+    elf_error_t err = elf_validate(elf_head, head_size);
     if (err != ELF_OK) {
         vga_print_color("Error: ", LIGHT_RED);
         vga_print_color(elf_strerror(err), LIGHT_RED);
         vga_putc('\n');
+        fat_close(fd);
         return -1;
     }
 
-    heap_offset = 0;
+    heap_reset();
 
     setup_syscall_table();
 
     uint32_t entry;
-    err = elf_load(elf_buffer, bytes_read, &entry);
+    err = map_image(fd, (uint32_t)fat_fsize(fd), &entry);
     if (err != ELF_OK) {
         vga_print_color("Load error: ", LIGHT_RED);
         vga_print_color(elf_strerror(err), LIGHT_RED);
@@ -322,7 +487,7 @@ int elf_exec(const char* path) {
 
         if (err == ELF_ERR_LOAD_FAILED) {
             elf_info_t info;
-            if (elf_get_info(elf_buffer, bytes_read, &info) == ELF_OK) {
+            if (elf_get_info(elf_head, head_size, &info) == ELF_OK) {
                 vga_print_color("Program address: 0x", YELLOW);
                 char buf[16];
                 itoa(info.load_addr, buf, 16);
@@ -330,16 +495,25 @@ int elf_exec(const char* path) {
                 vga_print_color(" - 0x", YELLOW);
                 itoa(info.bss_end, buf, 16);
                 vga_print(buf);
-                vga_print_color("\nAllowed: 0x110000 - 0xA00000\n", YELLOW);
+                vga_print_color("\nAllowed: 0x", YELLOW);
+                itoa(load_window_start(), buf, 16);
+                vga_print(buf);
+                vga_print_color(" - 0xA00000\n", YELLOW);
                 vga_print_color("Recompile with linker script\n", YELLOW);
             }
         }
+        fat_close(fd);
         return -1;
     }
 
     elf_entry_fn program = (elf_entry_fn)entry;
     int result = program();
 
+    unmap_image();
+    fat_close(fd);
+
+    /* Whatever the program did not free goes back to the page allocator */
+    heap_reset();
     return result;
 }
 
@@ -17,9 +17,26 @@
 #define EM_386          3
 #define PT_LOAD         1
 
+/* Programs are linked to fixed addresses inside this window */
+#define KERNEL_RESERVED_END 0x110000
+#define SAFE_LOAD_MAX       0xA00000
+
 #define SYSCALL_TABLE_ADDR  0x100000
 #define SYSCALL_MAGIC_VALUE 0xA105C411
 
+/* Filled by syscall_table_t.heap_stats (version 4+) */
+typedef struct {
+    uint32_t    arenas;         /* Page blocks backing the heap */
+    uint32_t    heap_bytes;     /* Their total size */
+    uint32_t    used_bytes;     /* Allocated blocks, including headers */
+    uint32_t    peak_used;
+    uint32_t    free_bytes;
+    uint32_t    largest_free;   /* Largest block malloc can return without growing */
+    uint32_t    allocs;
+    uint32_t    frees;
+    uint32_t    failures;
+} program_heap_stats_t;
+
 typedef struct {
     uint32_t    magic;
     uint32_t    version;
@@ -51,6 +68,11 @@ typedef struct {
     
     void*       (*malloc)(uint32_t size);
     void        (*free)(void* ptr);
+
+    /* Version 4 */
+    void*       (*realloc)(void* ptr, uint32_t size);
+    void*       (*calloc)(uint32_t count, uint32_t size);
+    void        (*heap_stats)(program_heap_stats_t* stats);
 } syscall_table_t;
 
 typedef struct {
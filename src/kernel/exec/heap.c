@@ -0,0 +1,282 @@
+#include "heap.h"
+#include "../mm/pmm.h"
+#include "../drivers/vga/vga.h"
+#include "../utils/string.h"
+#include "../drivers/vga/colors.h"
+
+/*
+ * Block layout: a 4-byte header and footer hold the block size (multiple
+ * of 8, both tags included) with bit 0 set while allocated. Free blocks
+ * keep their list links in the payload. Each arena starts with a used
+ * "prologue" footer and ends with a used zero-size "epilogue" header, so
+ * coalescing never walks out of it.
+ */
+#define HEAP_USED           1u
+#define HEAP_ALIGN          8u
+#define HEAP_TAGS           8u
+#define HEAP_MIN_BLOCK      ((HEAP_TAGS + 2 * sizeof(void*) + HEAP_ALIGN - 1) & ~(HEAP_ALIGN - 1))
+
+typedef struct heap_arena {
+    struct heap_arena*  next;
+    uint32_t            bytes;
+} heap_arena_t;
+
+#define HEAP_ARENA_HDR      ((sizeof(heap_arena_t) + HEAP_ALIGN - 1) & ~(HEAP_ALIGN - 1))
+
+typedef struct heap_free {
+    struct heap_free*   next;
+    struct heap_free*   prev;
+} heap_free_t;
+
+static heap_arena_t* arenas = NULL;
+static heap_free_t* free_lists[HEAP_CLASSES];
+static program_heap_stats_t stats;
+
+static inline uint32_t* hdr_of(void* payload)        { return (uint32_t*)payload - 1; }
+static inline void* payload_of(uint32_t* hdr)        { return hdr + 1; }
+static inline uint32_t block_size(const uint32_t* h) { return *h & ~HEAP_USED; }
+static inline uint32_t* next_hdr(uint32_t* h)        { return (uint32_t*)((uint8_t*)h + block_size(h)); }
+static inline uint32_t* prev_ftr(uint32_t* h)        { return h - 1; }
+
+static inline void set_tags(uint32_t* h, uint32_t size, uint32_t used) {
+    *h = size | used;
+    *(uint32_t*)((uint8_t*)h + size - 4) = size | used;
+}
+
+/* Class c holds sizes in [2^(c+4), 2^(c+5)); the last class is open-ended */
+static int size_class(uint32_t size) {
+    int c = 0;
+    while (c < HEAP_CLASSES - 1 && (size >> (c + 5)) != 0) c++;
+    return c;
+}
+
+static void list_insert(uint32_t* h) {
+    heap_free_t* node = (heap_free_t*)payload_of(h);
+    int c = size_class(block_size(h));
+    node->prev = NULL;
+    node->next = free_lists[c];
+    if (node->next) node->next->prev = node;
+    free_lists[c] = node;
+}
+
+static void list_remove(uint32_t* h) {
+    heap_free_t* node = (heap_free_t*)payload_of(h);
+    if (node->prev) node->prev->next = node->next;
+    else free_lists[size_class(block_size(h))] = node->next;
+    if (node->next) node->next->prev = node->prev;
+}
+
+static uint32_t* arena_first(heap_arena_t* a) {
+    return (uint32_t*)((uint8_t*)a + HEAP_ARENA_HDR + 4);
+}
+
+static void arena_release(heap_arena_t* a) {
+    heap_arena_t** link = &arenas;
+    while (*link != a) link = &(*link)->next;
+    *link = a->next;
+
+    stats.arenas--;
+    stats.heap_bytes -= a->bytes;
+    pmm_free_pages(a);
+}
+
+/* Marks a block free, merges it with free neighbours and files it */
+static void make_free(uint32_t* h, uint32_t size) {
+    set_tags(h, size, 0);
+
+    uint32_t* next = next_hdr(h);
+    if (!(*next & HEAP_USED)) {
+        list_remove(next);
+        size += block_size(next);
+        set_tags(h, size, 0);
+    }
+
+    uint32_t* ftr = prev_ftr(h);
+    if (!(*ftr & HEAP_USED)) {
+        uint32_t* prev = (uint32_t*)((uint8_t*)h - (*ftr & ~HEAP_USED));
+        list_remove(prev);
+        size += block_size(prev);
+        h = prev;
+        set_tags(h, size, 0);
+    }
+
+    /*
+     * Bounded by the prologue and the epilogue: the whole arena is free and
+     * goes back to the page allocator, unless it is the last one.
+     */
+    if (*prev_ftr(h) == HEAP_USED && *next_hdr(h) == HEAP_USED && stats.arenas > 1) {
+        arena_release((heap_arena_t*)((uint8_t*)h - HEAP_ARENA_HDR - 4));
+        return;
+    }
+
+    list_insert(h);
+}
+
+static int heap_grow(uint32_t need) {
+    uint32_t bytes = need + HEAP_ARENA_HDR + HEAP_TAGS;
+    if (bytes < need || bytes < HEAP_ARENA_MIN) bytes = HEAP_ARENA_MIN;
+
+    uint32_t order = pmm_order_for_size(bytes);
+    if (order > PMM_MAX_ORDER) return -1;
+
+    heap_arena_t* a = (heap_arena_t*)pmm_alloc_pages(order, PMM_OWNER_PROGRAM_HEAP);
+    if (!a) return -1;
+
+    a->bytes = PMM_PAGE_SIZE << order;
+    a->next = arenas;
+    arenas = a;
+    stats.arenas++;
+    stats.heap_bytes += a->bytes;
+
+    uint32_t* first = arena_first(a);
+    uint32_t size = a->bytes - HEAP_ARENA_HDR - HEAP_TAGS;
+    *prev_ftr(first) = HEAP_USED;                               /* Prologue */
+    *(uint32_t*)((uint8_t*)first + size) = HEAP_USED;           /* Epilogue */
+    set_tags(first, size, 0);
+    list_insert(first);
+    return 0;
+}
+
+static uint32_t* find_fit(uint32_t need) {
+    int c = size_class(need);
+
+    /* The first class may hold smaller blocks; anything in a higher class fits */
+    for (heap_free_t* n = free_lists[c]; n; n = n->next) {
+        uint32_t* h = hdr_of(n);
+        if (block_size(h) >= need) return h;
+    }
+    for (c++; c < HEAP_CLASSES; c++) {
+        if (free_lists[c]) return hdr_of(free_lists[c]);
+    }
+    return NULL;
+}
+
+/* Trims an allocated block to need bytes, freeing the tail if it is big enough */
+static void shrink_block(uint32_t* h, uint32_t need) {
+    uint32_t size = block_size(h);
+    if (size - need < HEAP_MIN_BLOCK) return;
+
+    set_tags(h, need, HEAP_USED);
+    make_free(next_hdr(h), size - need);
+    stats.used_bytes -= size - need;
+}
+
+static uint32_t block_need(uint32_t size) {
+    uint32_t need = (size + HEAP_TAGS + HEAP_ALIGN - 1) & ~(HEAP_ALIGN - 1);
+    if (need < size) return 0;      /* Overflow */
+    return need < HEAP_MIN_BLOCK ? HEAP_MIN_BLOCK : need;
+}
+
+static void note_used(uint32_t bytes) {
+    stats.used_bytes += bytes;
+    if (stats.used_bytes > stats.peak_used) stats.peak_used = stats.used_bytes;
+}
+
+void heap_reset(void) {
+    while (arenas) arena_release(arenas);
+    memset(free_lists, 0, sizeof(free_lists));
+    memset(&stats, 0, sizeof(stats));
+}
+
+void* heap_malloc(uint32_t size) {
+    uint32_t need = block_need(size);
+    if (size == 0 || need == 0) return NULL;
+
+    uint32_t* h = find_fit(need);
+    if (!h) {
+        if (heap_grow(need) < 0) {
+            stats.failures++;
+            return NULL;
+        }
+        h = find_fit(need);
+    }
+
+    list_remove(h);
+    uint32_t got = block_size(h);
+    set_tags(h, got, HEAP_USED);
+    note_used(got);
+    shrink_block(h, need);
+
+    stats.allocs++;
+    return payload_of(h);
+}
+
+static int heap_check(void* ptr) {
+    uint32_t* h = hdr_of(ptr);
+    if (((uintptr_t)ptr & (HEAP_ALIGN - 1)) || !(*h & HEAP_USED) || block_size(h) < HEAP_MIN_BLOCK ||
+        *(uint32_t*)((uint8_t*)h + block_size(h) - 4) != *h) {
+        vga_print_color("heap: invalid pointer\n", LIGHT_RED);
+        return -1;
+    }
+    return 0;
+}
+
+void heap_free(void* ptr) {
+    if (!ptr || heap_check(ptr) < 0) return;
+
+    uint32_t* h = hdr_of(ptr);
+    stats.used_bytes -= block_size(h);
+    stats.frees++;
+    make_free(h, block_size(h));
+}
+
+void* heap_realloc(void* ptr, uint32_t size) {
+    if (!ptr) return heap_malloc(size);
+    if (size == 0) {
+        heap_free(ptr);
+        return NULL;
+    }
+    if (heap_check(ptr) < 0) return NULL;
+
+    uint32_t need = block_need(size);
+    if (need == 0) return NULL;
+
+    uint32_t* h = hdr_of(ptr);
+    uint32_t have = block_size(h);
+
+    /* Grow in place by absorbing a free successor */
+    if (need > have) {
+        uint32_t* next = next_hdr(h);
+        if (!(*next & HEAP_USED) && have + block_size(next) >= need) {
+            uint32_t extra = block_size(next);
+            list_remove(next);
+            set_tags(h, have + extra, HEAP_USED);
+            note_used(extra);
+            have += extra;
+        }
+    }
+
+    if (need <= have) {
+        shrink_block(h, need);
+        return ptr;
+    }
+
+    void* moved = heap_malloc(size);
+    if (!moved) return NULL;
+    memcpy(moved, ptr, have - HEAP_TAGS);
+    heap_free(ptr);
+    return moved;
+}
+
+void* heap_calloc(uint32_t count, uint32_t size) {
+    if (size && count > 0xFFFFFFFFu / size) return NULL;
+
+    void* ptr = heap_malloc(count * size);
+    if (ptr) memset(ptr, 0, count * size);
+    return ptr;
+}
+
+void heap_get_stats(program_heap_stats_t* out) {
+    *out = stats;
+
+    uint32_t overhead = stats.arenas * (HEAP_ARENA_HDR + HEAP_TAGS);
+    out->free_bytes = stats.heap_bytes - overhead - stats.used_bytes;
+
+    out->largest_free = 0;
+    for (int c = HEAP_CLASSES - 1; c >= 0 && out->largest_free == 0; c--) {
+        for (heap_free_t* n = free_lists[c]; n; n = n->next) {
+            uint32_t payload = block_size(hdr_of(n)) - HEAP_TAGS;
+            if (payload > out->largest_free) out->largest_free = payload;
+        }
+    }
+}
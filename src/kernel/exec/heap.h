@@ -0,0 +1,24 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <stdint.h>
+#include "elf.h"
+
+/*
+ * Heap for loaded programs (syscall_table_t.malloc and friends).
+ * Boundary-tagged blocks on segregated free lists, in arenas taken from
+ * the page allocator; everything is released when the program exits.
+ */
+#define HEAP_ARENA_MIN      (64 * 1024)
+#define HEAP_CLASSES        20
+
+void heap_reset(void);
+
+void* heap_malloc(uint32_t size);
+void heap_free(void* ptr);
+void* heap_realloc(void* ptr, uint32_t size);
+void* heap_calloc(uint32_t count, uint32_t size);
+
+void heap_get_stats(program_heap_stats_t* stats);
+
+#endif
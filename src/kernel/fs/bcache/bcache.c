@@ -0,0 +1,496 @@
+#include "bcache.h"
+#include "../../drivers/block/blockdev.h"
+#include "../../utils/string.h"
+
+#define BCACHE_HASH_SIZE    1024
+#define BCACHE_NONE         (-1)
+
+/* Largest single device request (16-bit sector count, drivers split it further) */
+#define BCACHE_IO_MAX       0xFFFF
+
+/* Readahead is staged here (64 KB) */
+#define BCACHE_STAGE_BLOCKS 128
+
+typedef struct {
+    uint32_t    lba;
+    uint8_t     drive;
+    uint8_t     valid;
+    uint8_t     dirty;
+    int         hash_next;
+    int         prev;           /* Towards MRU */
+    int         next;           /* Towards LRU, or next free entry */
+} bcache_entry_t;
+
+static bcache_entry_t bcache_entries[BCACHE_MAX_BLOCKS];
+static uint8_t bcache_data[BCACHE_MAX_BLOCKS][BCACHE_BLOCK_SIZE] __attribute__((aligned(16)));
+static int bcache_hash[BCACHE_HASH_SIZE];
+
+static int bcache_mru = BCACHE_NONE;
+static int bcache_lru = BCACHE_NONE;
+static int bcache_free = BCACHE_NONE;
+static uint8_t bcache_ready = 0;
+
+static bcache_stats_t bcache_stats;
+
+/* Drives written since their last cache flush, one bit per drive */
+static uint8_t bcache_unflushed = 0;
+
+static uint8_t bcache_stage[BCACHE_STAGE_BLOCKS * BCACHE_BLOCK_SIZE] __attribute__((aligned(16)));
+
+/* Readahead in flight into bcache_stage; its blocks enter the cache when collected */
+static uint8_t bcache_ra_active = 0;
+static uint8_t bcache_ra_drive;
+static blockdev_request_t bcache_ra_req;
+static int bcache_order[BCACHE_MAX_BLOCKS];
+
+static void bcache_init(void) {
+    for (int i = 0; i < BCACHE_HASH_SIZE; i++) {
+        bcache_hash[i] = BCACHE_NONE;
+    }
+
+    for (int i = 0; i < BCACHE_MAX_BLOCKS; i++) {
+        bcache_entries[i].valid = 0;
+        bcache_entries[i].dirty = 0;
+        bcache_entries[i].hash_next = BCACHE_NONE;
+        bcache_entries[i].prev = BCACHE_NONE;
+        bcache_entries[i].next = (i + 1 < BCACHE_MAX_BLOCKS) ? i + 1 : BCACHE_NONE;
+    }
+
+    bcache_free = 0;
+    bcache_mru = BCACHE_NONE;
+    bcache_lru = BCACHE_NONE;
+
+    memset(&bcache_stats, 0, sizeof(bcache_stats));
+    bcache_stats.capacity = BCACHE_DEFAULT_BLOCKS;
+
+    bcache_ready = 1;
+}
+
+static uint32_t bcache_hash_of(uint8_t drive, uint32_t lba) {
+    return (lba ^ ((uint32_t)drive << 7)) & (BCACHE_HASH_SIZE - 1);
+}
+
+static int bcache_lookup(uint8_t drive, uint32_t lba) {
+    int i = bcache_hash[bcache_hash_of(drive, lba)];
+    while (i != BCACHE_NONE) {
+        if (bcache_entries[i].lba == lba && bcache_entries[i].drive == drive) return i;
+        i = bcache_entries[i].hash_next;
+    }
+    return BCACHE_NONE;
+}
+
+static void bcache_hash_remove(int idx) {
+    int* link = &bcache_hash[bcache_hash_of(bcache_entries[idx].drive, bcache_entries[idx].lba)];
+    while (*link != BCACHE_NONE) {
+        if (*link == idx) {
+            *link = bcache_entries[idx].hash_next;
+            return;
+        }
+        link = &bcache_entries[*link].hash_next;
+    }
+}
+
+static void bcache_lru_unlink(int idx) {
+    bcache_entry_t* e = &bcache_entries[idx];
+
+    if (e->prev != BCACHE_NONE) bcache_entries[e->prev].next = e->next;
+    else bcache_mru = e->next;
+
+    if (e->next != BCACHE_NONE) bcache_entries[e->next].prev = e->prev;
+    else bcache_lru = e->prev;
+
+    e->prev = BCACHE_NONE;
+    e->next = BCACHE_NONE;
+}
+
+static void bcache_push_mru(int idx) {
+    bcache_entry_t* e = &bcache_entries[idx];
+    e->prev = BCACHE_NONE;
+    e->next = bcache_mru;
+    if (bcache_mru != BCACHE_NONE) bcache_entries[bcache_mru].prev = idx;
+    bcache_mru = idx;
+    if (bcache_lru == BCACHE_NONE) bcache_lru = idx;
+}
+
+static void bcache_push_lru(int idx) {
+    bcache_entry_t* e = &bcache_entries[idx];
+    e->next = BCACHE_NONE;
+    e->prev = bcache_lru;
+    if (bcache_lru != BCACHE_NONE) bcache_entries[bcache_lru].next = idx;
+    bcache_lru = idx;
+    if (bcache_mru == BCACHE_NONE) bcache_mru = idx;
+}
+
+static void bcache_touch(int idx) {
+    if (bcache_mru == idx) return;
+    bcache_lru_unlink(idx);
+    bcache_push_mru(idx);
+}
+
+static void bcache_set_dirty(int idx, uint8_t dirty) {
+    bcache_entry_t* e = &bcache_entries[idx];
+    if (e->dirty == dirty) return;
+    e->dirty = dirty;
+    if (dirty) bcache_stats.dirty++;
+    else bcache_stats.dirty--;
+}
+
+/*
+ * Every device write goes through here. Writes are not flushed one by one;
+ * bcache_sync() issues a single cache flush per drive that was written.
+ */
+static int bcache_dev_write(uint8_t drive, uint32_t lba, uint32_t count, const void* buffer) {
+    if (blockdev_write(drive, lba, (uint16_t)count, buffer) < 0) return -1;
+    bcache_stats.dev_writes++;
+    if (drive < BLOCKDEV_MAX) bcache_unflushed |= (uint8_t)(1 << drive);
+    return 0;
+}
+
+static int bcache_writeback(int idx) {
+    bcache_entry_t* e = &bcache_entries[idx];
+    if (!e->dirty) return 0;
+
+    if (bcache_dev_write(e->drive, e->lba, 1, bcache_data[idx]) < 0) return -1;
+
+    bcache_stats.writebacks++;
+    bcache_set_dirty(idx, 0);
+    return 0;
+}
+
+static int bcache_evict(int idx) {
+    if (bcache_writeback(idx) < 0) return -1;
+
+    bcache_lru_unlink(idx);
+    bcache_hash_remove(idx);
+    bcache_entries[idx].valid = 0;
+    bcache_entries[idx].next = bcache_free;
+    bcache_free = idx;
+
+    bcache_stats.used--;
+    return 0;
+}
+
+/*
+ * Take a slot for (drive, lba). Streaming ("cold") blocks are queued at the
+ * LRU end so a large transfer recycles a single slot instead of flushing
+ * the hot directory and FAT sectors out of the cache.
+ */
+static int bcache_alloc(uint8_t drive, uint32_t lba, int cold) {
+    if (bcache_free == BCACHE_NONE || bcache_stats.used >= bcache_stats.capacity) {
+        if (bcache_lru == BCACHE_NONE) return BCACHE_NONE;
+        if (bcache_evict(bcache_lru) < 0) return BCACHE_NONE;
+        bcache_stats.evictions++;
+    }
+
+    int idx = bcache_free;
+    bcache_free = bcache_entries[idx].next;
+
+    bcache_entry_t* e = &bcache_entries[idx];
+    e->drive = drive;
+    e->lba = lba;
+    e->valid = 1;
+    e->dirty = 0;
+
+    uint32_t h = bcache_hash_of(drive, lba);
+    e->hash_next = bcache_hash[h];
+    bcache_hash[h] = idx;
+
+    if (cold) bcache_push_lru(idx);
+    else bcache_push_mru(idx);
+
+    bcache_stats.used++;
+    return idx;
+}
+
+/*
+ * Wait for the readahead in flight and file its blocks. Every entry point
+ * that may touch a device calls this first: the device is busy until then,
+ * and the blocks it brings must be visible before the cache is consulted.
+ */
+static void bcache_ra_collect(void) {
+    if (!bcache_ra_active) return;
+    bcache_ra_active = 0;
+
+    if (blockdev_finish(bcache_ra_drive, &bcache_ra_req) < 0) return;
+
+    for (uint32_t k = 0; k < bcache_ra_req.count; k++) {
+        uint32_t lba = bcache_ra_req.lba + k;
+        if (bcache_lookup(bcache_ra_drive, lba) != BCACHE_NONE) continue;
+
+        int slot = bcache_alloc(bcache_ra_drive, lba, 0);
+        if (slot == BCACHE_NONE) break;
+        memcpy(bcache_data[slot], bcache_stage + k * BCACHE_BLOCK_SIZE, BCACHE_BLOCK_SIZE);
+    }
+}
+
+int bcache_read(uint8_t drive, uint32_t lba, uint32_t count, void* buffer) {
+    if (!bcache_ready) bcache_init();
+    bcache_ra_collect();
+
+    uint8_t* buf = (uint8_t*)buffer;
+    int cold = count > BCACHE_STREAM_BLOCKS;
+    uint32_t i = 0;
+
+    while (i < count) {
+        int idx = bcache_lookup(drive, lba + i);
+        if (idx != BCACHE_NONE) {
+            memcpy(buf + i * BCACHE_BLOCK_SIZE, bcache_data[idx], BCACHE_BLOCK_SIZE);
+            if (cold) {
+                /* Streamed data is used once: readahead blocks go first */
+                bcache_lru_unlink(idx);
+                bcache_push_lru(idx);
+            } else {
+                bcache_touch(idx);
+            }
+            bcache_stats.hits++;
+            i++;
+            continue;
+        }
+
+        /* Gather the run of missing blocks and fetch it in one command */
+        uint32_t run = 1;
+        while (i + run < count && run < BCACHE_IO_MAX &&
+               bcache_lookup(drive, lba + i + run) == BCACHE_NONE) {
+            run++;
+        }
+
+        if (blockdev_read(drive, lba + i, (uint16_t)run, buf + i * BCACHE_BLOCK_SIZE) < 0) {
+            return -1;
+        }
+        bcache_stats.dev_reads++;
+        bcache_stats.misses += run;
+
+        for (uint32_t k = 0; k < run; k++) {
+            int slot = bcache_alloc(drive, lba + i + k, cold);
+            if (slot == BCACHE_NONE) continue;
+            memcpy(bcache_data[slot], buf + (i + k) * BCACHE_BLOCK_SIZE, BCACHE_BLOCK_SIZE);
+        }
+
+        i += run;
+    }
+
+    return 0;
+}
+
+/*
+ * Readahead: start reading the blocks of [lba, lba + count) that are not
+ * cached yet and return without waiting. The request is collected by the
+ * next cache call, so the transfer overlaps whatever the reader does in
+ * between. Only one request is in flight: when the range holds several
+ * missing runs, all but the last are waited for here.
+ */
+int bcache_prefetch(uint8_t drive, uint32_t lba, uint32_t count) {
+    if (!bcache_ready) bcache_init();
+    if (count > bcache_stats.capacity / 2) count = bcache_stats.capacity / 2;
+
+    uint32_t i = 0;
+    while (i < count) {
+        if (bcache_lookup(drive, lba + i) != BCACHE_NONE) {
+            i++;
+            continue;
+        }
+
+        uint32_t run = 1;
+        while (i + run < count && run < BCACHE_STAGE_BLOCKS &&
+               bcache_lookup(drive, lba + i + run) == BCACHE_NONE) {
+            run++;
+        }
+
+        /* The stage buffer and the device are still owned by the previous run */
+        bcache_ra_collect();
+
+        bcache_ra_req.lba = lba + i;
+        bcache_ra_req.count = (uint16_t)run;
+        bcache_ra_req.write = 0;
+        bcache_ra_req.buffer = bcache_stage;
+        if (blockdev_start(drive, &bcache_ra_req) < 0) return -1;
+
+        bcache_ra_active = 1;
+        bcache_ra_drive = drive;
+        bcache_stats.dev_reads++;
+        bcache_stats.prefetched += run;
+
+        i += run;
+    }
+
+    return 0;
+}
+
+int bcache_write(uint8_t drive, uint32_t lba, uint32_t count, const void* buffer) {
+    if (!bcache_ready) bcache_init();
+    bcache_ra_collect();
+
+    const uint8_t* buf = (const uint8_t*)buffer;
+
+    if (count > BCACHE_STREAM_BLOCKS) {
+        /* Bulk data is written through, cached copies are refreshed in place */
+        uint32_t done = 0;
+        while (done < count) {
+            uint32_t chunk = count - done;
+            if (chunk > BCACHE_IO_MAX) chunk = BCACHE_IO_MAX;
+
+            if (bcache_dev_write(drive, lba + done, chunk, buf + done * BCACHE_BLOCK_SIZE) < 0) {
+                return -1;
+            }
+            done += chunk;
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            int idx = bcache_lookup(drive, lba + i);
+            if (idx == BCACHE_NONE) continue;
+            memcpy(bcache_data[idx], buf + i * BCACHE_BLOCK_SIZE, BCACHE_BLOCK_SIZE);
+            bcache_set_dirty(idx, 0);
+        }
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        int idx = bcache_lookup(drive, lba + i);
+        if (idx == BCACHE_NONE) {
+            /* Whole block is overwritten, no need to read it first */
+            idx = bcache_alloc(drive, lba + i, 0);
+            if (idx == BCACHE_NONE) {
+                if (bcache_dev_write(drive, lba + i, 1, buf + i * BCACHE_BLOCK_SIZE) < 0) return -1;
+                continue;
+            }
+        } else {
+            bcache_touch(idx);
+        }
+
+        memcpy(bcache_data[idx], buf + i * BCACHE_BLOCK_SIZE, BCACHE_BLOCK_SIZE);
+        bcache_set_dirty(idx, 1);
+    }
+
+    return 0;
+}
+
+static int bcache_before(int a, int b) {
+    if (bcache_entries[a].drive != bcache_entries[b].drive) {
+        return bcache_entries[a].drive < bcache_entries[b].drive;
+    }
+    return bcache_entries[a].lba < bcache_entries[b].lba;
+}
+
+static blockdev_queue_t bcache_queue;
+static int bcache_queued[BLOCKDEV_QUEUE_MAX];   /* Entry index of each queued block */
+
+/* Write out the queued dirty blocks as one batch and mark the ones that made it clean */
+static int bcache_queue_flush(void) {
+    uint32_t n = bcache_queue.count;
+    if (n == 0) return 0;
+
+    int result = blockdev_queue_run(&bcache_queue);
+    bcache_stats.dev_writes += bcache_queue.issued;
+    if (bcache_queue.id < BLOCKDEV_MAX) bcache_unflushed |= (uint8_t)(1 << bcache_queue.id);
+
+    for (uint32_t i = 0; i < n; i++) {
+        if (bcache_queue.reqs[i].status < 0) continue;
+        bcache_set_dirty(bcache_queued[i], 0);
+        bcache_stats.writebacks++;
+    }
+    return result;
+}
+
+/*
+ * Dirty blocks go to the drive's request queue in LBA order; the queue
+ * merges neighbours into multi-sector commands and submits each batch at once.
+ */
+int bcache_sync(uint8_t drive) {
+    if (!bcache_ready) return 0;
+    bcache_ra_collect();
+
+    int n = 0;
+    for (int i = 0; i < BCACHE_MAX_BLOCKS; i++) {
+        bcache_entry_t* e = &bcache_entries[i];
+        if (!e->valid || !e->dirty) continue;
+        if (drive != BCACHE_ALL_DRIVES && e->drive != drive) continue;
+
+        /* Insertion sort: the dirty set is small */
+        int j = n;
+        while (j > 0 && bcache_before(i, bcache_order[j - 1])) {
+            bcache_order[j] = bcache_order[j - 1];
+            j--;
+        }
+        bcache_order[j] = i;
+        n++;
+    }
+
+    int result = 0;
+    bcache_queue.count = 0;
+    for (int k = 0; k < n; k++) {
+        bcache_entry_t* e = &bcache_entries[bcache_order[k]];
+
+        if (bcache_queue.count > 0 &&
+            (bcache_queue.id != e->drive || bcache_queue.count == BLOCKDEV_QUEUE_MAX)) {
+            if (bcache_queue_flush() < 0) result = -1;
+        }
+        if (bcache_queue.count == 0) blockdev_queue_init(&bcache_queue, e->drive);
+
+        int slot = blockdev_queue_add(&bcache_queue, e->lba, 1, 1, bcache_data[bcache_order[k]]);
+        bcache_queued[slot] = bcache_order[k];
+    }
+    if (bcache_queue_flush() < 0) result = -1;
+
+    /* One write barrier per drive covers everything written so far */
+    for (uint8_t d = 0; d < BLOCKDEV_MAX; d++) {
+        if (!(bcache_unflushed & (1 << d))) continue;
+        if (drive != BCACHE_ALL_DRIVES && drive != d) continue;
+
+        if (blockdev_flush(d) < 0) {
+            result = -1;
+            continue;
+        }
+        bcache_unflushed &= (uint8_t)~(1 << d);
+        bcache_stats.flushes++;
+    }
+
+    return result;
+}
+
+void bcache_invalidate(uint8_t drive) {
+    if (!bcache_ready) return;
+
+    bcache_sync(drive);
+
+    for (int i = 0; i < BCACHE_MAX_BLOCKS; i++) {
+        bcache_entry_t* e = &bcache_entries[i];
+        if (!e->valid) continue;
+        if (drive != BCACHE_ALL_DRIVES && e->drive != drive) continue;
+
+        /* A block that failed to write back is dropped as well */
+        bcache_set_dirty(i, 0);
+        bcache_evict(i);
+    }
+}
+
+int bcache_set_size(uint32_t blocks) {
+    if (blocks == 0 || blocks > BCACHE_MAX_BLOCKS) return -1;
+    if (!bcache_ready) bcache_init();
+    bcache_ra_collect();
+
+    bcache_stats.capacity = blocks;
+
+    while (bcache_stats.used > bcache_stats.capacity) {
+        if (bcache_evict(bcache_lru) < 0) return -1;
+        bcache_stats.evictions++;
+    }
+    return 0;
+}
+
+void bcache_get_stats(bcache_stats_t* out) {
+    if (!bcache_ready) bcache_init();
+    memcpy(out, &bcache_stats, sizeof(bcache_stats_t));
+}
+
+void bcache_reset_stats(void) {
+    if (!bcache_ready) bcache_init();
+
+    bcache_stats.hits = 0;
+    bcache_stats.misses = 0;
+    bcache_stats.dev_reads = 0;
+    bcache_stats.dev_writes = 0;
+    bcache_stats.writebacks = 0;
+    bcache_stats.evictions = 0;
+    bcache_stats.prefetched = 0;
+    bcache_stats.flushes = 0;
+}
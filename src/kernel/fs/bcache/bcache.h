@@ -0,0 +1,59 @@
+#ifndef BCACHE_H
+#define BCACHE_H
+
+#include <stdint.h>
+
+/*
+ * Block buffer cache shared by all filesystems.
+ * Blocks are 512-byte device sectors keyed by (drive, LBA), evicted in LRU
+ * order and written back lazily: dirty blocks reach the disk on eviction or
+ * on bcache_sync().
+ */
+
+#define BCACHE_BLOCK_SIZE       512
+#define BCACHE_MAX_BLOCKS       1024    /* Hard upper bound (512 KB) */
+#define BCACHE_DEFAULT_BLOCKS   512
+
+/* Requests longer than this are streaming data: they do not displace hot metadata */
+#define BCACHE_STREAM_BLOCKS    8
+
+#define BCACHE_ALL_DRIVES       0xFF
+
+typedef struct {
+    uint32_t    hits;
+    uint32_t    misses;
+    uint32_t    dev_reads;      /* Read commands sent to the device */
+    uint32_t    dev_writes;     /* Write commands sent to the device */
+    uint32_t    writebacks;     /* Dirty blocks written back */
+    uint32_t    evictions;
+    uint32_t    prefetched;     /* Blocks read ahead of demand */
+    uint32_t    flushes;        /* Device cache flushes (write barriers) */
+    uint32_t    capacity;       /* Configured size in blocks */
+    uint32_t    used;
+    uint32_t    dirty;
+} bcache_stats_t;
+
+int bcache_read(uint8_t drive, uint32_t lba, uint32_t count, void* buffer);
+int bcache_write(uint8_t drive, uint32_t lba, uint32_t count, const void* buffer);
+
+/*
+ * Start reading blocks into the cache ahead of use; nothing is copied out.
+ * The read may still be running on return: the next cache call collects
+ * it, so code that goes to the device directly calls bcache_sync() or
+ * bcache_invalidate() first.
+ */
+int bcache_prefetch(uint8_t drive, uint32_t lba, uint32_t count);
+
+/* Write back dirty blocks of one drive (or BCACHE_ALL_DRIVES) and flush its write cache */
+int bcache_sync(uint8_t drive);
+
+/* Write back and drop every block of a drive, e.g. when media may have changed */
+void bcache_invalidate(uint8_t drive);
+
+/* Change capacity (1..BCACHE_MAX_BLOCKS); shrinking evicts LRU blocks */
+int bcache_set_size(uint32_t blocks);
+
+void bcache_get_stats(bcache_stats_t* out);
+void bcache_reset_stats(void);
+
+#endif
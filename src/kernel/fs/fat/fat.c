@@ -1,5 +1,8 @@
 #include "fat.h"
-#include "../../drivers/ata/ata.h"
+#include "fat_dcache.h"
+#include "../../drivers/block/blockdev.h"
+#include "../bcache/bcache.h"
+#include "../../mm/kmalloc.h"
 #include "../../drivers/vga/vga.h"
 #include "../../utils/string.h"
 #include "../../drivers/vga/colors.h"
@@ -76,6 +79,20 @@ typedef struct __attribute__((packed)) {
     uint16_t    name3[2];
 } fat_lfn_entry_t;
 
+typedef struct __attribute__((packed)) {
+    uint32_t    lead_sig;
+    uint8_t     reserved1[480];
+    uint32_t    struct_sig;
+    uint32_t    free_count;
+    uint32_t    next_free;
+    uint8_t     reserved2[12];
+    uint32_t    trail_sig;
+} fat32_fsinfo_t;
+
+#define FAT_FSINFO_LEAD_SIG     0x41615252
+#define FAT_FSINFO_STRUCT_SIG   0x61417272
+#define FAT_FREE_UNKNOWN        0xFFFFFFFF
+
 #define MAX_SECTOR_SIZE     4096
 #define DIR_ENTRY_SIZE      32
 
@@ -91,6 +108,7 @@ static struct {
 
     uint32_t    fat_start_sector;
     uint32_t    fat_size_sectors;
+    uint8_t     num_fats;           /* Copies kept in sync on flush */
     uint32_t    root_dir_sector;
     uint32_t    root_dir_sectors;
     uint32_t    data_start_sector;
@@ -109,38 +127,58 @@ static struct {
     uint8_t     fat_cache[MAX_SECTOR_SIZE];
     uint8_t     fat_cache_dirty;
 
-} fat_state;
+    uint8_t     fat_in_memory;
+    uint32_t    free_clusters;      /* FAT_FREE_UNKNOWN if not counted */
+    uint32_t    next_free;
+    uint32_t    fsinfo_sector;      /* 0 if the volume has no valid FSInfo */
+    uint8_t     fsinfo_dirty;
 
-static int read_sector(uint32_t sector, void* buffer) {
-    if (fat_state.bytes_per_sector == 512) {
-        return ata_read_sectors(fat_state.drive, sector, 1, buffer);
-    }
+    /* Location of the entry handed to the read_dir_entries() callback */
+    uint32_t    dir_entry_sector;
+    uint16_t    dir_entry_index;
 
-    uint32_t ata_sector = sector * fat_state.ata_sectors_per_fs_sector;
-    uint8_t* buf = (uint8_t*)buffer;
+    /* Location and on-disk name of the last entry matched by fat_find_in_dir() */
+    uint32_t    found_sector;           /* 0 if none */
+    uint16_t    found_index;
+    char        found_name[FAT_MAX_NAME];
 
-    for (int i = 0; i < fat_state.ata_sectors_per_fs_sector; i++) {
-        if (ata_read_sectors(fat_state.drive, ata_sector + i, 1, buf + (i * 512)) < 0) {
-            return -1;
-        }
-    }
-    return 0;
+} fat_state;
+
+/*
+ * Whole-FAT copy and used-cluster bitmap, allocated at mount to the size of
+ * the volume. Volumes with a larger FAT (or no memory) fall back to fat_cache.
+ */
+#define FAT_TABLE_MAX_BYTES     (1024 * 1024)
+
+static uint8_t* fat_table = NULL;
+static uint8_t fat_table_dirty[FAT_TABLE_MAX_BYTES / 512 / 8];
+static uint32_t* fat_used_map = NULL;
+
+/* All volume I/O goes through the block cache in 512-byte device sectors */
+static int read_sectors(uint32_t sector, uint32_t count, void* buffer) {
+    return bcache_read(fat_state.drive,
+                       sector * fat_state.ata_sectors_per_fs_sector,
+                       count * fat_state.ata_sectors_per_fs_sector, buffer);
 }
 
-static int write_sector(uint32_t sector, const void* buffer) {
-    if (fat_state.bytes_per_sector == 512) {
-        return ata_write_sectors(fat_state.drive, sector, 1, buffer);
-    }
+static int write_sectors(uint32_t sector, uint32_t count, const void* buffer) {
+    return bcache_write(fat_state.drive,
+                        sector * fat_state.ata_sectors_per_fs_sector,
+                        count * fat_state.ata_sectors_per_fs_sector, buffer);
+}
 
-    uint32_t ata_sector = sector * fat_state.ata_sectors_per_fs_sector;
-    const uint8_t* buf = (const uint8_t*)buffer;
+static int prefetch_sectors(uint32_t sector, uint32_t count) {
+    return bcache_prefetch(fat_state.drive,
+                           sector * fat_state.ata_sectors_per_fs_sector,
+                           count * fat_state.ata_sectors_per_fs_sector);
+}
 
-    for (int i = 0; i < fat_state.ata_sectors_per_fs_sector; i++) {
-        if (ata_write_sectors(fat_state.drive, ata_sector + i, 1, buf + (i * 512)) < 0) {
-            return -1;
-        }
-    }
-    return 0;
+static int read_sector(uint32_t sector, void* buffer) {
+    return read_sectors(sector, 1, buffer);
+}
+
+static int write_sector(uint32_t sector, const void* buffer) {
+    return write_sectors(sector, 1, buffer);
 }
 
 static void to_upper(char* str) {
@@ -155,19 +193,237 @@ static uint32_t cluster_to_sector(uint32_t cluster) {
            (cluster - 2) * fat_state.sectors_per_cluster;
 }
 
+/* Writes the cached FAT sector to every FAT copy (sector-cache mode only) */
+static int fat_cache_flush(void) {
+    if (!fat_state.fat_cache_dirty) return 0;
+
+    uint32_t offset = fat_state.fat_cache_sector - fat_state.fat_start_sector;
+    int result = 0;
+    for (uint8_t f = 0; f < fat_state.num_fats; f++) {
+        uint32_t copy = fat_state.fat_start_sector + f * fat_state.fat_size_sectors;
+        if (write_sector(copy + offset, fat_state.fat_cache) < 0) result = -1;
+    }
+    fat_state.fat_cache_dirty = 0;
+    return result;
+}
+
 static int fat_cache_load(uint32_t sector) {
     if (fat_state.fat_cache_sector == sector) return 0;
 
-    if (fat_state.fat_cache_dirty) {
-        write_sector(fat_state.fat_cache_sector, fat_state.fat_cache);
-        fat_state.fat_cache_dirty = 0;
-    }
+    fat_cache_flush();
 
     if (read_sector(sector, fat_state.fat_cache) < 0) return -1;
     fat_state.fat_cache_sector = sector;
     return 0;
 }
 
+static void fat_table_mark_dirty(uint32_t offset, uint32_t len) {
+    uint32_t first = offset / fat_state.bytes_per_sector;
+    uint32_t last = (offset + len - 1) / fat_state.bytes_per_sector;
+    for (uint32_t s = first; s <= last; s++) {
+        fat_table_dirty[s / 8] |= (uint8_t)(1 << (s % 8));
+    }
+}
+
+static uint32_t fat_table_get(uint32_t cluster) {
+    uint32_t value;
+
+    switch (fat_state.type) {
+        case FAT_TYPE_12: {
+            uint32_t off = cluster + (cluster / 2);
+            value = fat_table[off] | ((uint32_t)fat_table[off + 1] << 8);
+            if (cluster & 1) value >>= 4;
+            else value &= 0x0FFF;
+            if (value >= 0x0FF8) value = 0x0FFFFFFF;
+            break;
+        }
+        case FAT_TYPE_16:
+            value = *(uint16_t*)&fat_table[cluster * 2];
+            if (value >= 0xFFF8) value = 0x0FFFFFFF;
+            break;
+
+        case FAT_TYPE_32:
+            value = *(uint32_t*)&fat_table[cluster * 4] & 0x0FFFFFFF;
+            if (value >= 0x0FFFFFF8) value = 0x0FFFFFFF;
+            break;
+
+        default:
+            return 0xFFFFFFFF;
+    }
+
+    return value;
+}
+
+static void fat_table_put(uint32_t cluster, uint32_t value) {
+    switch (fat_state.type) {
+        case FAT_TYPE_12: {
+            uint32_t off = cluster + (cluster / 2);
+            if (cluster & 1) {
+                fat_table[off] = (fat_table[off] & 0x0F) | ((value & 0x0F) << 4);
+                fat_table[off + 1] = (value >> 4) & 0xFF;
+            } else {
+                fat_table[off] = value & 0xFF;
+                fat_table[off + 1] = (fat_table[off + 1] & 0xF0) | ((value >> 8) & 0x0F);
+            }
+            fat_table_mark_dirty(off, 2);
+            break;
+        }
+        case FAT_TYPE_16:
+            *(uint16_t*)&fat_table[cluster * 2] = (uint16_t)value;
+            fat_table_mark_dirty(cluster * 2, 2);
+            break;
+
+        case FAT_TYPE_32: {
+            uint32_t* entry = (uint32_t*)&fat_table[cluster * 4];
+            *entry = (*entry & 0xF0000000) | (value & 0x0FFFFFFF);
+            fat_table_mark_dirty(cluster * 4, 4);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static void fat_used_map_set(uint32_t cluster, int used) {
+    if (used) fat_used_map[cluster / 32] |= 1u << (cluster % 32);
+    else fat_used_map[cluster / 32] &= ~(1u << (cluster % 32));
+}
+
+/*
+ * Load the whole FAT at mount when it fits in fat_table and build the used
+ * bitmap and free counter from it. Larger volumes keep the single-sector
+ * cache and a linear search from the next-free hint.
+ */
+static void fat_table_release(void) {
+    kfree(fat_table);
+    kfree(fat_used_map);
+    fat_table = NULL;
+    fat_used_map = NULL;
+    fat_state.fat_in_memory = 0;
+}
+
+static int fat_table_load(void) {
+    uint32_t limit = fat_state.total_clusters + 2;
+    uint32_t bytes = fat_state.fat_size_sectors * fat_state.bytes_per_sector;
+    uint32_t words = (limit + 31) / 32;
+
+    fat_table_release();
+    fat_state.free_clusters = FAT_FREE_UNKNOWN;
+
+    if (bytes <= FAT_TABLE_MAX_BYTES) {
+        fat_table = (uint8_t*)kmalloc(bytes);
+        fat_used_map = (uint32_t*)kmalloc(words * 4);
+        if (!fat_table || !fat_used_map) fat_table_release();
+    }
+
+    if (fat_table) {
+        if (read_sectors(fat_state.fat_start_sector, fat_state.fat_size_sectors, fat_table) < 0) {
+            fat_table_release();
+            return -1;
+        }
+        memset(fat_table_dirty, 0, sizeof(fat_table_dirty));
+        fat_state.fat_in_memory = 1;
+
+        memset(fat_used_map, 0, words * 4);
+        fat_used_map_set(0, 1);
+        fat_used_map_set(1, 1);
+        for (uint32_t c = limit; c < words * 32; c++) {
+            fat_used_map_set(c, 1);
+        }
+
+        uint32_t free_count = 0;
+        for (uint32_t c = 2; c < limit; c++) {
+            if (fat_table_get(c) == 0) free_count++;
+            else fat_used_map_set(c, 1);
+        }
+        fat_state.free_clusters = free_count;
+    }
+
+    fat_state.next_free = 2;
+
+    if (fat_state.fsinfo_sector != 0) {
+        if (read_sector(fat_state.fsinfo_sector, fat_state.sector_buf) < 0) return -1;
+
+        fat32_fsinfo_t* fsi = (fat32_fsinfo_t*)fat_state.sector_buf;
+        if (fsi->lead_sig == FAT_FSINFO_LEAD_SIG && fsi->struct_sig == FAT_FSINFO_STRUCT_SIG) {
+            if (fsi->next_free >= 2 && fsi->next_free < limit) {
+                fat_state.next_free = fsi->next_free;
+            }
+            if (!fat_state.fat_in_memory && fsi->free_count <= fat_state.total_clusters) {
+                fat_state.free_clusters = fsi->free_count;
+            }
+        } else {
+            fat_state.fsinfo_sector = 0;
+        }
+    }
+
+    fat_state.fsinfo_dirty = 0;
+    return 0;
+}
+
+/* Write dirty FAT sectors to all copies, merging adjacent ones, then FSInfo */
+static int fat_flush(void) {
+    int result = 0;
+
+    if (fat_state.fat_in_memory) {
+        uint16_t bps = fat_state.bytes_per_sector;
+        uint32_t sectors = fat_state.fat_size_sectors;
+        uint32_t s = 0;
+
+        while (s < sectors) {
+            if (fat_table_dirty[s / 8] == 0) {
+                s = (s / 8 + 1) * 8;
+                continue;
+            }
+            if (!(fat_table_dirty[s / 8] & (1 << (s % 8)))) {
+                s++;
+                continue;
+            }
+
+            uint32_t run = 1;
+            while (s + run < sectors &&
+                   (fat_table_dirty[(s + run) / 8] & (1 << ((s + run) % 8)))) {
+                run++;
+            }
+
+            for (uint8_t f = 0; f < fat_state.num_fats; f++) {
+                uint32_t copy = fat_state.fat_start_sector + f * fat_state.fat_size_sectors;
+                if (write_sectors(copy + s, run, fat_table + s * bps) < 0) result = -1;
+            }
+
+            for (uint32_t k = s; k < s + run; k++) {
+                fat_table_dirty[k / 8] &= (uint8_t)~(1 << (k % 8));
+            }
+            s += run;
+        }
+    } else if (fat_cache_flush() < 0) {
+        result = -1;
+    }
+
+    if (fat_state.fsinfo_dirty && fat_state.fsinfo_sector != 0) {
+        if (read_sector(fat_state.fsinfo_sector, fat_state.sector_buf) < 0) return -1;
+
+        fat32_fsinfo_t* fsi = (fat32_fsinfo_t*)fat_state.sector_buf;
+        fsi->free_count = fat_state.free_clusters;
+        fsi->next_free = fat_state.next_free;
+        if (write_sector(fat_state.fsinfo_sector, fat_state.sector_buf) < 0) result = -1;
+    }
+    fat_state.fsinfo_dirty = 0;
+
+    return result;
+}
+
+/*
+ * End of a mutating operation: push FAT changes into the block cache,
+ * write back everything that is dirty on this volume and flush the drive's
+ * write cache. This is the only write barrier; data writes are not flushed.
+ */
+static int fat_commit(void) {
+    int result = fat_flush();
+    if (bcache_sync(fat_state.drive) < 0) result = -1;
+    return result;
+}
+
 static uint32_t fat_get_entry(uint32_t cluster) {
     uint32_t fat_offset;
     uint32_t fat_sector;
@@ -175,6 +431,11 @@ static uint32_t fat_get_entry(uint32_t cluster) {
     uint32_t value = 0;
     uint16_t bps = fat_state.bytes_per_sector;
 
+    if (fat_state.fat_in_memory) {
+        if (cluster >= fat_state.total_clusters + 2) return 0x0FFFFFFF;
+        return fat_table_get(cluster);
+    }
+
     switch (fat_state.type) {
         case FAT_TYPE_12:
             fat_offset = cluster + (cluster / 2);
@@ -227,7 +488,7 @@ static uint32_t fat_get_entry(uint32_t cluster) {
     return value;
 }
 
-static int fat_set_entry(uint32_t cluster, uint32_t value) {
+static int fat_cache_put(uint32_t cluster, uint32_t value) {
     uint32_t fat_offset;
     uint32_t fat_sector;
     uint32_t ent_offset;
@@ -247,7 +508,6 @@ static int fat_set_entry(uint32_t cluster, uint32_t value) {
 
                 if (ent_offset == (uint32_t)(bps - 1)) {
                     fat_state.fat_cache_dirty = 1;
-                    write_sector(fat_sector, fat_state.fat_cache);
                     if (fat_cache_load(fat_sector + 1) < 0) return -1;
                     fat_state.fat_cache[0] = (value >> 4) & 0xFF;
                 } else {
@@ -258,7 +518,6 @@ static int fat_set_entry(uint32_t cluster, uint32_t value) {
 
                 if (ent_offset == (uint32_t)(bps - 1)) {
                     fat_state.fat_cache_dirty = 1;
-                    write_sector(fat_sector, fat_state.fat_cache);
                     if (fat_cache_load(fat_sector + 1) < 0) return -1;
                     fat_state.fat_cache[0] =
                         (fat_state.fat_cache[0] & 0xF0) | ((value >> 8) & 0x0F);
@@ -298,35 +557,193 @@ static int fat_set_entry(uint32_t cluster, uint32_t value) {
     return 0;
 }
 
-static uint32_t fat_alloc_cluster(void) {
-    for (uint32_t i = 2; i < fat_state.total_clusters + 2; i++) {
-        if (fat_get_entry(i) == 0) {
-            uint32_t eoc;
-            switch (fat_state.type) {
-                case FAT_TYPE_12: eoc = 0x0FFF; break;
-                case FAT_TYPE_16: eoc = 0xFFFF; break;
-                case FAT_TYPE_32: eoc = 0x0FFFFFFF; break;
-                default: return 0;
-            }
-            fat_set_entry(i, eoc);
+/* Every FAT update goes through here so the used bitmap and free counter stay exact */
+static int fat_set_entry(uint32_t cluster, uint32_t value) {
+    if (cluster < 2 || cluster >= fat_state.total_clusters + 2) return -1;
 
-            if (fat_state.fat_cache_dirty) {
-                write_sector(fat_state.fat_cache_sector, fat_state.fat_cache);
-                fat_state.fat_cache_dirty = 0;
-            }
+    int was_free = (fat_get_entry(cluster) == 0);
 
-            memset(fat_state.sector_buf, 0, fat_state.bytes_per_sector);
-            uint32_t sector = cluster_to_sector(i);
-            for (int s = 0; s < fat_state.sectors_per_cluster; s++) {
-                write_sector(sector + s, fat_state.sector_buf);
-            }
+    if (fat_state.fat_in_memory) {
+        fat_table_put(cluster, value);
+    } else if (fat_cache_put(cluster, value) < 0) {
+        return -1;
+    }
+
+    int now_free = ((value & 0x0FFFFFFF) == 0);
+    if (was_free != now_free) {
+        if (fat_state.fat_in_memory) fat_used_map_set(cluster, !now_free);
+        if (fat_state.free_clusters != FAT_FREE_UNKNOWN) {
+            if (now_free) fat_state.free_clusters++;
+            else fat_state.free_clusters--;
+        }
+        fat_state.fsinfo_dirty = 1;
+    }
+    return 0;
+}
+
+/*
+ * Walk the chain from `cluster` while the next cluster is physically adjacent.
+ * Returns the number of contiguous clusters (at most `max`) and stores the
+ * cluster that follows the run in *next, so callers can move a whole extent
+ * with one multi-sector transfer.
+ */
+static uint32_t fat_cluster_run(uint32_t cluster, uint32_t max, uint32_t* next) {
+    uint32_t run = 1;
+    uint32_t following = fat_get_entry(cluster);
+
+    while (run < max && following == cluster + run) {
+        run++;
+        following = fat_get_entry(following);
+    }
+
+    *next = following;
+    return run;
+}
+
+/*
+ * Move up to `bytes` bytes between a caller buffer and `count` contiguous
+ * clusters, starting `offset` bytes into the first one. Whole sectors are
+ * transferred directly in as few commands as possible; only partial head
+ * and tail sectors go through sector_buf.
+ */
+static int fat_read_run(uint32_t cluster, uint32_t count, uint32_t offset,
+                        uint8_t* dst, uint32_t bytes) {
+    uint16_t bps = fat_state.bytes_per_sector;
+    uint32_t run_bytes = count * fat_state.sectors_per_cluster * bps - offset;
+    if (run_bytes > bytes) run_bytes = bytes;
+
+    uint32_t sector = cluster_to_sector(cluster) + offset / bps;
+    uint32_t skip = offset % bps;
+    uint32_t done = 0;
+
+    if (skip > 0) {
+        if (read_sector(sector, fat_state.sector_buf) < 0) return -1;
+        done = bps - skip;
+        if (done > run_bytes) done = run_bytes;
+        memcpy(dst, fat_state.sector_buf + skip, done);
+        sector++;
+    }
+
+    uint32_t full = (run_bytes - done) / bps;
+    if (full > 0 && read_sectors(sector, full, dst + done) < 0) return -1;
+    done += full * bps;
+    sector += full;
+
+    if (done < run_bytes) {
+        if (read_sector(sector, fat_state.sector_buf) < 0) return -1;
+        memcpy(dst + done, fat_state.sector_buf, run_bytes - done);
+    }
+    return (int)run_bytes;
+}
+
+/*
+ * A partial head sector is always merged with what is on disk. A partial
+ * tail sector is merged only when `keep_tail` says file data follows it,
+ * otherwise it is zero-padded.
+ */
+static int fat_write_run(uint32_t cluster, uint32_t count, uint32_t offset,
+                         const uint8_t* src, uint32_t bytes, int keep_tail) {
+    uint16_t bps = fat_state.bytes_per_sector;
+    uint32_t run_bytes = count * fat_state.sectors_per_cluster * bps - offset;
+    if (run_bytes > bytes) run_bytes = bytes;
+
+    uint32_t sector = cluster_to_sector(cluster) + offset / bps;
+    uint32_t skip = offset % bps;
+    uint32_t done = 0;
+
+    if (skip > 0) {
+        if (read_sector(sector, fat_state.sector_buf) < 0) return -1;
+        done = bps - skip;
+        if (done > run_bytes) done = run_bytes;
+        memcpy(fat_state.sector_buf + skip, src, done);
+        if (write_sector(sector, fat_state.sector_buf) < 0) return -1;
+        sector++;
+    }
+
+    uint32_t full = (run_bytes - done) / bps;
+    if (full > 0 && write_sectors(sector, full, src + done) < 0) return -1;
+    done += full * bps;
+    sector += full;
+
+    if (done < run_bytes) {
+        if (keep_tail) {
+            if (read_sector(sector, fat_state.sector_buf) < 0) return -1;
+        } else {
+            memset(fat_state.sector_buf, 0, bps);
+        }
+        memcpy(fat_state.sector_buf, src + done, run_bytes - done);
+        if (write_sector(sector, fat_state.sector_buf) < 0) return -1;
+    }
+    return (int)run_bytes;
+}
 
-            return i;
+static void fat_zero_cluster(uint32_t cluster) {
+    memset(fat_state.sector_buf, 0, fat_state.bytes_per_sector);
+    uint32_t sector = cluster_to_sector(cluster);
+    for (int s = 0; s < fat_state.sectors_per_cluster; s++) {
+        write_sector(sector + s, fat_state.sector_buf);
+    }
+}
+
+/* First free cluster at or after the next-free hint, wrapping around once */
+static uint32_t fat_find_free(void) {
+    uint32_t limit = fat_state.total_clusters + 2;
+    uint32_t start = fat_state.next_free;
+
+    if (fat_state.free_clusters == 0) return 0;
+    if (start < 2 || start >= limit) start = 2;
+
+    if (fat_state.fat_in_memory) {
+        uint32_t words = (limit + 31) / 32;
+        uint32_t w = start / 32;
+
+        /* One extra step revisits the first word for bits below the hint */
+        for (uint32_t n = 0; n <= words; n++) {
+            uint32_t used = fat_used_map[w];
+            if (n == 0) used |= (1u << (start % 32)) - 1;
+            if (used != 0xFFFFFFFF) {
+                return w * 32 + (uint32_t)__builtin_ctz(~used);
+            }
+            w = (w + 1 == words) ? 0 : w + 1;
         }
+        return 0;
+    }
+
+    for (uint32_t n = 0; n < fat_state.total_clusters; n++) {
+        uint32_t c = start + n;
+        if (c >= limit) c -= fat_state.total_clusters;
+        if (fat_get_entry(c) == 0) return c;
     }
     return 0;
 }
 
+static uint32_t fat_eoc(void) {
+    switch (fat_state.type) {
+        case FAT_TYPE_12: return 0x0FFF;
+        case FAT_TYPE_16: return 0xFFFF;
+        default: return 0x0FFFFFFF;
+    }
+}
+
+/* Data clusters are not zeroed here: callers either overwrite them or use fat_zero_cluster() */
+static uint32_t fat_alloc_cluster(void) {
+    uint32_t cluster = fat_find_free();
+    if (cluster == 0) return 0;
+
+    if (fat_set_entry(cluster, fat_eoc()) < 0) return 0;
+
+    fat_state.next_free = cluster + 1;
+    return cluster;
+}
+
+static void fat_free_chain(uint32_t cluster) {
+    while (cluster >= 2 && cluster < 0x0FFFFFF8) {
+        uint32_t next = fat_get_entry(cluster);
+        fat_set_entry(cluster, 0);
+        cluster = next;
+    }
+}
+
 static uint8_t lfn_checksum(const char* short_name) {
     uint8_t sum = 0;
     for (int i = 0; i < 11; i++) {
@@ -452,6 +869,8 @@ static int read_dir_entries(uint32_t start_cluster,
                     fat_name_to_str(&entries[i], name);
                 }
 
+                fat_state.dir_entry_sector = fat_state.root_dir_sector + s;
+                fat_state.dir_entry_index = i;
                 if (callback(&entries[i], name, ctx) != 0) return 1;
             }
         }
@@ -499,6 +918,8 @@ static int read_dir_entries(uint32_t start_cluster,
                     fat_name_to_str(&entries[i], name);
                 }
 
+                fat_state.dir_entry_sector = sector + s;
+                fat_state.dir_entry_index = i;
                 if (callback(&entries[i], name, ctx) != 0) return 1;
             }
         }
@@ -532,15 +953,33 @@ static int find_callback(fat_dir_entry_t* entry, char* name, void* ctx) {
     if (strcmp(upper_name, upper_target) == 0) {
         memcpy(fctx->result, entry, sizeof(fat_dir_entry_t));
         fctx->found = 1;
+        fat_state.found_sector = fat_state.dir_entry_sector;
+        fat_state.found_index = fat_state.dir_entry_index;
+        strcpy(fat_state.found_name, name);
         return 1;
     }
     return 0;
 }
 
 static int fat_find_in_dir(uint32_t dir_cluster, const char* name, fat_dir_entry_t* out) {
+    fat_state.found_sector = 0;
+
+    int cached = fat_dcache_lookup(dir_cluster, name, out, &fat_state.found_sector,
+                                   &fat_state.found_index, fat_state.found_name);
+    if (cached == FAT_DCACHE_HIT) return 0;
+    if (cached == FAT_DCACHE_NEGATIVE) return -1;
+
     find_ctx_t ctx = { name, out, 0 };
-    read_dir_entries(dir_cluster, find_callback, &ctx);
-    return ctx.found ? 0 : -1;
+    if (read_dir_entries(dir_cluster, find_callback, &ctx) < 0) return -1;
+
+    if (!ctx.found) {
+        fat_dcache_insert(dir_cluster, name, 0, 0, 0, 0);
+        return -1;
+    }
+
+    fat_dcache_insert(dir_cluster, name, out, fat_state.found_sector,
+                      fat_state.found_index, fat_state.found_name);
+    return 0;
 }
 
 static uint32_t get_entry_cluster(fat_dir_entry_t* entry) {
@@ -564,6 +1003,10 @@ static int fat_resolve_path(const char* path, uint32_t* out_cluster, fat_dir_ent
     char component[FAT_MAX_NAME];
     fat_dir_entry_t entry;
 
+    memset(&entry, 0, sizeof(entry));
+    entry.attr = FAT_ATTR_DIRECTORY;
+    fat_state.found_sector = 0;
+
     while (*path) {
         while (*path == '/') path++;
         if (!*path) break;
@@ -605,76 +1048,519 @@ static int fat_resolve_path(const char* path, uint32_t* out_cluster, fat_dir_ent
     return 0;
 }
 
-int fat_mount(uint8_t drive) {
-    if (fat_state.mounted) {
-        fat_unmount();
-    }
+/* Wrapper around fat_resolve_path() that also returns where the entry lives */
+static int fat_lookup(const char* path, fat_dir_entry_t* out, uint32_t* sector, uint16_t* index) {
+    uint32_t cluster;
+    if (fat_resolve_path(path, &cluster, out) < 0) return -1;
+    if (fat_state.found_sector == 0) return -1;
 
-    ata_init();
+    *sector = fat_state.found_sector;
+    *index = fat_state.found_index;
+    return 0;
+}
 
-    if (!ata_drive_exists(drive)) {
-        vga_print_color("Drive not found\n", LIGHT_RED);
-        return -1;
-    }
+/* Run of physically contiguous clusters: file clusters [index, index + count) */
+typedef struct {
+    uint32_t    index;
+    uint32_t    cluster;
+    uint32_t    count;
+} fat_extent_t;
 
-    uint8_t boot_sector[512];
-    if (ata_read_sectors(drive, 0, 1, boot_sector) < 0) {
-        vga_print_color("Failed to read boot sector\n", LIGHT_RED);
-        return -1;
-    }
+#define FAT_HANDLE_EXTENTS  128
 
-    bpb_t* bpb = (bpb_t*)boot_sector;
+/* Readahead window bounds in bytes; the window doubles on every sequential read */
+#define FAT_READAHEAD_MIN   4096
+#define FAT_READAHEAD_MAX   (64 * 1024)
 
-    uint16_t bps = bpb->bytes_per_sector;
-    if (bps != 512 && bps != 1024 && bps != 2048 && bps != 4096) {
-        vga_print_color("Unsupported sector size: ", LIGHT_RED);
-        char buf[16];
-        itoa(bps, buf, 10);
-        vga_print(buf);
-        vga_print_color("\nSupported: 512, 1024, 2048, 4096\n", LIGHT_RED);
-        return -1;
+typedef struct {
+    uint8_t     used;
+    uint8_t     flags;
+    uint8_t     dirty;              /* Directory entry is out of date */
+
+    uint32_t    entry_sector;       /* Where the short entry lives */
+    uint16_t    entry_index;
+
+    uint32_t    first_cluster;
+    uint32_t    size;
+    uint32_t    pos;
+
+    uint32_t    last_cluster;       /* Tail of the chain, valid for writers */
+    uint32_t    cluster_count;
+
+    /*
+     * Extent map of the chain, built lazily as it is walked. Past the
+     * last extent slot, lookups fall back to the chain cursor.
+     */
+    fat_extent_t extents[FAT_HANDLE_EXTENTS];
+    uint16_t    extent_count;
+    uint32_t    mapped;             /* File clusters [0, mapped) are in the map */
+
+    /* Chain cursor: cur_cluster is cluster number cur_index of the file */
+    uint32_t    cur_cluster;
+    uint32_t    cur_index;
+
+    /* Readahead: next expected offset, current window, end of prefetched data */
+    uint32_t    ra_next;
+    uint32_t    ra_window;
+    uint32_t    ra_end;
+} fat_handle_t;
+
+static fat_handle_t fat_handles[FAT_MAX_OPEN_FILES];
+
+/*
+ * Chain tails remembered from closed writers, so reopening a file for
+ * append does not walk its cluster chain again.
+ */
+#define FAT_TAIL_HINTS  4
+
+typedef struct {
+    uint32_t    entry_sector;       /* 0 if unused */
+    uint16_t    entry_index;
+    uint32_t    first_cluster;
+    uint32_t    last_cluster;
+    uint32_t    cluster_count;
+} fat_tail_hint_t;
+
+static fat_tail_hint_t fat_tail_hints[FAT_TAIL_HINTS];
+static uint8_t fat_tail_next;
+
+static const uint8_t fat_zero_block[MAX_SECTOR_SIZE];
+
+static fat_handle_t* fat_handle_get(int fd) {
+    if (fd < 0 || fd >= FAT_MAX_OPEN_FILES) return 0;
+    if (!fat_handles[fd].used) return 0;
+    return &fat_handles[fd];
+}
+
+static fat_tail_hint_t* fat_tail_find(uint32_t sector, uint16_t index) {
+    for (int i = 0; i < FAT_TAIL_HINTS; i++) {
+        if (fat_tail_hints[i].entry_sector == sector && fat_tail_hints[i].entry_index == index) {
+            return &fat_tail_hints[i];
+        }
     }
+    return 0;
+}
 
-    if (bpb->num_fats == 0 || bpb->sectors_per_cluster == 0) {
-        vga_print_color("Invalid BPB\n", LIGHT_RED);
-        return -1;
+static void fat_tail_remember(const fat_handle_t* h) {
+    fat_tail_hint_t* hint = fat_tail_find(h->entry_sector, h->entry_index);
+    if (!hint) {
+        hint = &fat_tail_hints[fat_tail_next];
+        fat_tail_next = (fat_tail_next + 1) % FAT_TAIL_HINTS;
     }
 
-    fat_state.drive = drive;
-    fat_state.bytes_per_sector = bps;
-    fat_state.sectors_per_cluster = bpb->sectors_per_cluster;
-    fat_state.entries_per_sector = bps / DIR_ENTRY_SIZE;
-    fat_state.ata_sectors_per_fs_sector = bps / 512;
+    hint->entry_sector = h->entry_sector;
+    hint->entry_index = h->entry_index;
+    hint->first_cluster = h->first_cluster;
+    hint->last_cluster = h->last_cluster;
+    hint->cluster_count = h->cluster_count;
+}
 
-    if (bps > 512) {
-        memcpy(fat_state.sector_buf, boot_sector, 512);
-        for (int i = 1; i < fat_state.ata_sectors_per_fs_sector; i++) {
-            if (ata_read_sectors(drive, i, 1, fat_state.sector_buf + (i * 512)) < 0) {
-                vga_print_color("Failed to read full boot sector\n", LIGHT_RED);
-                return -1;
-            }
+static void fat_tail_drop(uint32_t sector, uint16_t index) {
+    fat_tail_hint_t* hint = fat_tail_find(sector, index);
+    if (hint) hint->entry_sector = 0;
+}
+
+/* Open handles pin a file: it cannot be removed, truncated or opened for writing under them */
+static int fat_handle_busy(uint32_t sector, uint16_t index) {
+    for (int i = 0; i < FAT_MAX_OPEN_FILES; i++) {
+        if (fat_handles[i].used && fat_handles[i].entry_sector == sector &&
+            fat_handles[i].entry_index == index) {
+            return 1;
         }
-        bpb = (bpb_t*)fat_state.sector_buf;
     }
+    return 0;
+}
 
-    fat_state.fat_start_sector = bpb->reserved_sectors;
-
-    uint32_t fat_size;
-    if (bpb->fat_size_16 != 0) {
-        fat_size = bpb->fat_size_16;
-    } else {
-        fat32_ebpb_t* fat32 = (fat32_ebpb_t*)(bps > 512 ? fat_state.sector_buf : boot_sector);
-        fat_size = fat32->fat_size_32;
+/* Handles on a removed entry must not write it back or touch its clusters */
+static void fat_handle_forget(uint32_t sector, uint16_t index) {
+    for (int i = 0; i < FAT_MAX_OPEN_FILES; i++) {
+        if (fat_handles[i].used && fat_handles[i].entry_sector == sector &&
+            fat_handles[i].entry_index == index) {
+            fat_handles[i].used = 0;
+        }
     }
-    fat_state.fat_size_sectors = fat_size;
+    fat_tail_drop(sector, index);
+}
 
-    fat_state.root_dir_sector = fat_state.fat_start_sector + (bpb->num_fats * fat_size);
-    fat_state.root_dir_sectors = ((bpb->root_entry_count * 32) + (bps - 1)) / bps;
+static int fat_handle_store(fat_handle_t* h) {
+    if (!h->dirty) return 0;
 
-    fat_state.data_start_sector = fat_state.root_dir_sector + fat_state.root_dir_sectors;
+    if (read_sector(h->entry_sector, fat_state.sector_buf) < 0) return -1;
 
-    uint32_t total_sectors = (bpb->total_sectors_16 != 0) ?
-                             bpb->total_sectors_16 : bpb->total_sectors_32;
+    fat_dir_entry_t* entry = &((fat_dir_entry_t*)fat_state.sector_buf)[h->entry_index];
+    entry->cluster_lo = h->first_cluster & 0xFFFF;
+    entry->cluster_hi = (h->first_cluster >> 16) & 0xFFFF;
+    entry->file_size = h->size;
+
+    if (write_sector(h->entry_sector, fat_state.sector_buf) < 0) return -1;
+
+    fat_dcache_invalidate_location(h->entry_sector, h->entry_index);
+    h->dirty = 0;
+    return 0;
+}
+
+static void fat_extent_reset(fat_handle_t* h) {
+    h->extent_count = 0;
+    h->mapped = 0;
+    h->cur_cluster = 0;
+    h->cur_index = 0;
+}
+
+/* Add the next cluster of the chain to the map; -1 once the map is full */
+static int fat_extent_append(fat_handle_t* h, uint32_t cluster) {
+    if (h->extent_count > 0) {
+        fat_extent_t* last = &h->extents[h->extent_count - 1];
+        if (last->cluster + last->count == cluster) {
+            last->count++;
+            h->mapped++;
+            return 0;
+        }
+    }
+
+    if (h->extent_count == FAT_HANDLE_EXTENTS) return -1;
+
+    fat_extent_t* e = &h->extents[h->extent_count++];
+    e->index = h->mapped;
+    e->cluster = cluster;
+    e->count = 1;
+    h->mapped++;
+    return 0;
+}
+
+/*
+ * Physical cluster holding file cluster `index`, or 0 past the end of the
+ * chain. *run gets how many clusters from there on are contiguous (at most
+ * `want`), so callers can move them with one transfer.
+ */
+static uint32_t fat_handle_map(fat_handle_t* h, uint32_t index, uint32_t want, uint32_t* run) {
+    /* Map far enough to see the whole run the caller can use */
+    while (h->mapped < index + want) {
+        uint32_t next;
+        if (h->mapped == 0) {
+            next = h->first_cluster;
+        } else {
+            fat_extent_t* last = &h->extents[h->extent_count - 1];
+            next = fat_get_entry(last->cluster + last->count - 1);
+        }
+        if (next < 2 || next >= 0x0FFFFFF8) {
+            if (index >= h->mapped) return 0;
+            break;
+        }
+        if (fat_extent_append(h, next) < 0) break;
+    }
+
+    if (index < h->mapped) {
+        uint16_t lo = 0;
+        uint16_t hi = h->extent_count - 1;
+        while (lo < hi) {
+            uint16_t mid = (uint16_t)((lo + hi + 1) / 2);
+            if (h->extents[mid].index <= index) lo = mid;
+            else hi = mid - 1;
+        }
+
+        fat_extent_t* e = &h->extents[lo];
+        *run = e->index + e->count - index;
+        if (*run > want) *run = want;
+        return e->cluster + (index - e->index);
+    }
+
+    /* Fragmented beyond the map: walk on from the cursor or the last extent */
+    uint32_t cluster;
+    uint32_t at;
+    if (h->cur_cluster >= 2 && h->cur_index >= h->mapped && h->cur_index <= index) {
+        cluster = h->cur_cluster;
+        at = h->cur_index;
+    } else {
+        fat_extent_t* last = &h->extents[h->extent_count - 1];
+        cluster = last->cluster + last->count - 1;
+        at = h->mapped - 1;
+    }
+
+    while (at < index && cluster >= 2 && cluster < 0x0FFFFFF8) {
+        cluster = fat_get_entry(cluster);
+        at++;
+    }
+    if (cluster < 2 || cluster >= 0x0FFFFFF8) return 0;
+
+    uint32_t next;
+    *run = fat_cluster_run(cluster, want, &next);
+
+    h->cur_cluster = cluster + *run - 1;
+    h->cur_index = index + *run - 1;
+    return cluster;
+}
+
+static void fat_handle_scan_chain(fat_handle_t* h) {
+    fat_tail_hint_t* hint = fat_tail_find(h->entry_sector, h->entry_index);
+    if (hint && hint->first_cluster == h->first_cluster && hint->last_cluster >= 2 &&
+        fat_get_entry(hint->last_cluster) >= 0x0FFFFFF8) {
+        h->last_cluster = hint->last_cluster;
+        h->cluster_count = hint->cluster_count;
+        return;
+    }
+
+    h->last_cluster = 0;
+    h->cluster_count = 0;
+    fat_extent_reset(h);
+
+    /* The walk fills the extent map on the way */
+    uint32_t cluster = h->first_cluster;
+    while (cluster >= 2 && cluster < 0x0FFFFFF8) {
+        if (h->mapped == h->cluster_count) fat_extent_append(h, cluster);
+        h->last_cluster = cluster;
+        h->cluster_count++;
+        cluster = fat_get_entry(cluster);
+    }
+}
+
+/* Grow the chain to `clusters`; on failure everything added here is released */
+static int fat_handle_extend(fat_handle_t* h, uint32_t clusters) {
+    uint32_t old_last = h->last_cluster;
+    uint32_t old_count = h->cluster_count;
+    uint32_t added = 0;
+
+    while (h->cluster_count < clusters) {
+        uint32_t cluster = fat_alloc_cluster();
+        if (cluster == 0) {
+            if (old_last != 0) fat_set_entry(old_last, fat_eoc());
+            else h->first_cluster = 0;
+            fat_free_chain(added);
+
+            h->last_cluster = old_last;
+            h->cluster_count = old_count;
+            fat_extent_reset(h);
+            return -1;
+        }
+
+        if (h->last_cluster != 0) {
+            fat_set_entry(h->last_cluster, cluster);
+        } else {
+            h->first_cluster = cluster;
+            h->dirty = 1;
+        }
+        if (added == 0) added = cluster;
+
+        h->last_cluster = cluster;
+        h->cluster_count++;
+    }
+    return 0;
+}
+
+static void fat_handle_truncate(fat_handle_t* h) {
+    fat_tail_drop(h->entry_sector, h->entry_index);
+    fat_free_chain(h->first_cluster);
+    h->first_cluster = 0;
+    h->last_cluster = 0;
+    h->cluster_count = 0;
+    fat_extent_reset(h);
+    h->ra_window = 0;
+    h->ra_end = 0;
+    h->size = 0;
+    h->dirty = 1;
+}
+
+/* Pull file bytes [from, to) into the block cache, one command per extent */
+static void fat_handle_prefetch(fat_handle_t* h, uint32_t from, uint32_t to) {
+    uint16_t bps = fat_state.bytes_per_sector;
+    uint32_t cluster_bytes = (uint32_t)fat_state.sectors_per_cluster * bps;
+    uint32_t index = from / cluster_bytes;
+    uint32_t last = (to - 1) / cluster_bytes;
+
+    while (index <= last) {
+        uint32_t run;
+        uint32_t cluster = fat_handle_map(h, index, last - index + 1, &run);
+        if (cluster == 0) return;
+
+        /* File bytes of this run, clipped to [from, to) */
+        uint32_t start = index * cluster_bytes;
+        uint32_t end = (index + run) * cluster_bytes;
+        uint32_t lo = (from > start ? from - start : 0) / bps;
+        uint32_t hi = ((to < end ? to : end) - start + bps - 1) / bps;
+
+        if (prefetch_sectors(cluster_to_sector(cluster) + lo, hi - lo) < 0) return;
+
+        index += run;
+    }
+}
+
+/*
+ * Sequential access is detected per handle: a read that starts where the
+ * previous one ended grows the window, anything else drops it. Once the
+ * reader gets within half a window of the prefetched data, the next window
+ * is fetched in one go so the following reads are cache hits.
+ */
+static void fat_handle_readahead(fat_handle_t* h, uint32_t offset, uint32_t done) {
+    if (offset != h->ra_next) {
+        h->ra_window = 0;
+        h->ra_end = 0;
+        h->ra_next = offset + done;
+        return;
+    }
+
+    h->ra_next = offset + done;
+    if (h->ra_window == 0) h->ra_window = FAT_READAHEAD_MIN;
+    else if (h->ra_window < FAT_READAHEAD_MAX) h->ra_window *= 2;
+
+    if (h->ra_end < h->ra_next) h->ra_end = h->ra_next;
+    if (h->ra_end - h->ra_next >= h->ra_window / 2) return;
+
+    uint32_t end = h->ra_next + h->ra_window;
+    if (end > h->size || end < h->ra_next) end = h->size;
+    if (end <= h->ra_end) return;
+
+    fat_handle_prefetch(h, h->ra_end, end);
+    h->ra_end = end;
+}
+
+static int fat_handle_read(fat_handle_t* h, uint8_t* dst, uint32_t size, uint32_t offset) {
+    if (offset >= h->size) return 0;
+    if (size > h->size - offset) size = h->size - offset;
+
+    uint32_t cluster_bytes = (uint32_t)fat_state.sectors_per_cluster * fat_state.bytes_per_sector;
+    uint32_t index = offset / cluster_bytes;
+    uint32_t within = offset % cluster_bytes;
+    uint32_t done = 0;
+
+    while (done < size) {
+        uint32_t remaining = size - done;
+        uint32_t run;
+        uint32_t cluster = fat_handle_map(h, index, (within + remaining + cluster_bytes - 1) / cluster_bytes, &run);
+        if (cluster == 0) break;
+
+        int got = fat_read_run(cluster, run, within, dst + done, remaining);
+        if (got < 0) return -1;
+        done += (uint32_t)got;
+
+        index += run;
+        within = 0;
+    }
+
+    fat_handle_readahead(h, offset, done);
+    return (int)done;
+}
+
+static int fat_handle_write(fat_handle_t* h, const uint8_t* src, uint32_t size, uint32_t offset) {
+    if (size == 0) return 0;
+    if (offset + size < offset) return -1;
+
+    /* Writing past the end leaves a zero-filled gap */
+    while (h->size < offset) {
+        uint32_t gap = offset - h->size;
+        if (gap > sizeof(fat_zero_block)) gap = sizeof(fat_zero_block);
+        if (fat_handle_write(h, fat_zero_block, gap, h->size) < 0) return -1;
+    }
+
+    uint32_t cluster_bytes = (uint32_t)fat_state.sectors_per_cluster * fat_state.bytes_per_sector;
+    uint32_t end = offset + size;
+    uint32_t needed = (end + cluster_bytes - 1) / cluster_bytes;
+
+    if (needed > h->cluster_count && fat_handle_extend(h, needed) < 0) return -1;
+
+    int keep_tail = end < h->size;
+    uint32_t index = offset / cluster_bytes;
+    uint32_t within = offset % cluster_bytes;
+    uint32_t done = 0;
+
+    while (done < size) {
+        uint32_t remaining = size - done;
+        uint32_t run;
+        uint32_t cluster = fat_handle_map(h, index, (within + remaining + cluster_bytes - 1) / cluster_bytes, &run);
+        if (cluster == 0) break;
+
+        int put = fat_write_run(cluster, run, within, src + done, remaining, keep_tail);
+        if (put < 0) return -1;
+        done += (uint32_t)put;
+
+        index += run;
+        within = 0;
+    }
+
+    if (end > h->size) {
+        h->size = end;
+        h->dirty = 1;
+    }
+    return (int)done;
+}
+
+static void fat_handles_close_all(void) {
+    for (int i = 0; i < FAT_MAX_OPEN_FILES; i++) {
+        if (fat_handles[i].used) fat_handle_store(&fat_handles[i]);
+        fat_handles[i].used = 0;
+    }
+}
+
+int fat_mount(uint8_t drive) {
+    if (fat_state.mounted) {
+        fat_unmount();
+    }
+
+    if (!blockdev_exists(drive)) {
+        vga_print_color("Drive not found\n", LIGHT_RED);
+        return -1;
+    }
+
+    /* The medium may have been changed or rewritten behind our back */
+    bcache_invalidate(drive);
+
+    uint8_t boot_sector[512];
+    if (blockdev_read(drive, 0, 1, boot_sector) < 0) {
+        vga_print_color("Failed to read boot sector\n", LIGHT_RED);
+        return -1;
+    }
+
+    bpb_t* bpb = (bpb_t*)boot_sector;
+
+    uint16_t bps = bpb->bytes_per_sector;
+    if (bps != 512 && bps != 1024 && bps != 2048 && bps != 4096) {
+        vga_print_color("Unsupported sector size: ", LIGHT_RED);
+        char buf[16];
+        itoa(bps, buf, 10);
+        vga_print(buf);
+        vga_print_color("\nSupported: 512, 1024, 2048, 4096\n", LIGHT_RED);
+        return -1;
+    }
+
+    if (bpb->num_fats == 0 || bpb->sectors_per_cluster == 0) {
+        vga_print_color("Invalid BPB\n", LIGHT_RED);
+        return -1;
+    }
+
+    fat_state.drive = drive;
+    fat_state.bytes_per_sector = bps;
+    fat_state.sectors_per_cluster = bpb->sectors_per_cluster;
+    fat_state.entries_per_sector = bps / DIR_ENTRY_SIZE;
+    fat_state.ata_sectors_per_fs_sector = bps / 512;
+
+    if (bps > 512) {
+        memcpy(fat_state.sector_buf, boot_sector, 512);
+        for (int i = 1; i < fat_state.ata_sectors_per_fs_sector; i++) {
+            if (blockdev_read(drive, i, 1, fat_state.sector_buf + (i * 512)) < 0) {
+                vga_print_color("Failed to read full boot sector\n", LIGHT_RED);
+                return -1;
+            }
+        }
+        bpb = (bpb_t*)fat_state.sector_buf;
+    }
+
+    fat_state.fat_start_sector = bpb->reserved_sectors;
+
+    uint32_t fat_size;
+    if (bpb->fat_size_16 != 0) {
+        fat_size = bpb->fat_size_16;
+    } else {
+        fat32_ebpb_t* fat32 = (fat32_ebpb_t*)(bps > 512 ? fat_state.sector_buf : boot_sector);
+        fat_size = fat32->fat_size_32;
+    }
+    fat_state.fat_size_sectors = fat_size;
+    fat_state.num_fats = bpb->num_fats;
+
+    fat_state.root_dir_sector = fat_state.fat_start_sector + (bpb->num_fats * fat_size);
+    fat_state.root_dir_sectors = ((bpb->root_entry_count * 32) + (bps - 1)) / bps;
+
+    fat_state.data_start_sector = fat_state.root_dir_sector + fat_state.root_dir_sectors;
+
+    uint32_t total_sectors = (bpb->total_sectors_16 != 0) ?
+                             bpb->total_sectors_16 : bpb->total_sectors_32;
 
     uint32_t data_sectors = total_sectors - fat_state.data_start_sector;
     fat_state.total_clusters = data_sectors / bpb->sectors_per_cluster;
@@ -689,6 +1575,16 @@ int fat_mount(uint8_t drive) {
         fat_state.root_cluster = fat32->root_cluster;
         fat_state.root_dir_sectors = 0;
         fat_state.data_start_sector = fat_state.root_dir_sector;
+
+        if (fat32->fs_info != 0 && fat32->fs_info != 0xFFFF) {
+            fat_state.fsinfo_sector = fat32->fs_info;
+        }
+
+        /* Mirroring disabled: only the active FAT is used and updated */
+        if (fat32->ext_flags & 0x80) {
+            fat_state.fat_start_sector += (fat32->ext_flags & 0x0F) * fat_size;
+            fat_state.num_fats = 1;
+        }
     }
 
     if (fat_state.type == FAT_TYPE_32) {
@@ -711,6 +1607,15 @@ int fat_mount(uint8_t drive) {
     fat_state.fat_cache_sector = 0xFFFFFFFF;
     fat_state.fat_cache_dirty = 0;
 
+    memset(fat_handles, 0, sizeof(fat_handles));
+    memset(fat_tail_hints, 0, sizeof(fat_tail_hints));
+    fat_dcache_reset();
+
+    if (fat_table_load() < 0) {
+        vga_print_color("Failed to read FAT\n", LIGHT_RED);
+        return -1;
+    }
+
     fat_state.mounted = 1;
 
     return 0;
@@ -719,9 +1624,10 @@ int fat_mount(uint8_t drive) {
 void fat_unmount(void) {
     if (!fat_state.mounted) return;
 
-    if (fat_state.fat_cache_dirty) {
-        write_sector(fat_state.fat_cache_sector, fat_state.fat_cache);
-    }
+    fat_handles_close_all();
+    fat_commit();
+    fat_dcache_reset();
+    fat_table_release();
 
     memset(&fat_state, 0, sizeof(fat_state));
 }
@@ -730,6 +1636,10 @@ int fat_is_mounted(void) {
     return fat_state.mounted;
 }
 
+int fat_get_drive(void) {
+    return fat_state.mounted ? fat_state.drive : -1;
+}
+
 fat_type_t fat_get_type(void) {
     return fat_state.type;
 }
@@ -902,42 +1812,6 @@ int fat_cat(const char* path) {
     return 0;
 }
 
-int fat_read(const char* path, void* buffer, uint32_t max_size) {
-    if (!fat_state.mounted) return -1;
-
-    fat_dir_entry_t entry;
-    uint32_t cluster;
-
-    if (fat_resolve_path(path, &cluster, &entry) < 0) return -1;
-    if (entry.attr & FAT_ATTR_DIRECTORY) return -1;
-
-    uint32_t to_read = entry.file_size;
-    if (to_read > max_size) to_read = max_size;
-
-    uint32_t read_total = 0;
-    uint8_t* buf = (uint8_t*)buffer;
-    cluster = get_entry_cluster(&entry);
-    uint16_t bps = fat_state.bytes_per_sector;
-
-    while (cluster < 0x0FFFFFF8 && read_total < to_read) {
-        uint32_t sector = cluster_to_sector(cluster);
-
-        for (int s = 0; s < fat_state.sectors_per_cluster && read_total < to_read; s++) {
-            if (read_sector(sector + s, fat_state.sector_buf) < 0) return -1;
-
-            uint32_t chunk = to_read - read_total;
-            if (chunk > bps) chunk = bps;
-
-            memcpy(buf + read_total, fat_state.sector_buf, chunk);
-            read_total += chunk;
-        }
-
-        cluster = fat_get_entry(cluster);
-    }
-
-    return (int)read_total;
-}
-
 static int find_empty_entries(uint32_t dir_cluster, int count, uint32_t* out_sector, int* out_index) {
     int consecutive = 0;
     uint32_t first_sector = 0;
@@ -971,6 +1845,7 @@ static int find_empty_entries(uint32_t dir_cluster, int count, uint32_t* out_sec
     }
 
     uint32_t cluster = dir_cluster;
+    uint32_t last = dir_cluster;
     while (cluster < 0x0FFFFFF8) {
         uint32_t sector = cluster_to_sector(cluster);
 
@@ -996,16 +1871,25 @@ static int find_empty_entries(uint32_t dir_cluster, int count, uint32_t* out_sec
             }
         }
 
+        last = cluster;
         cluster = fat_get_entry(cluster);
     }
 
     uint32_t new_cluster = fat_alloc_cluster();
     if (new_cluster == 0) return -1;
-
-    fat_set_entry(cluster, new_cluster);
-    if (fat_state.fat_cache_dirty) {
-        write_sector(fat_state.fat_cache_sector, fat_state.fat_cache);
-        fat_state.fat_cache_dirty = 0;
+    fat_zero_cluster(new_cluster);
+
+    fat_set_entry(last, new_cluster);
+
+    /*
+     * A free run at the end of the last cluster continues into the new one.
+     * It has to be used: readers stop at the first 0x00 entry, so entries
+     * placed after it would be invisible.
+     */
+    if (consecutive > 0) {
+        *out_sector = first_sector;
+        *out_index = first_index;
+        return 0;
     }
 
     *out_sector = cluster_to_sector(new_cluster);
@@ -1013,6 +1897,19 @@ static int find_empty_entries(uint32_t dir_cluster, int count, uint32_t* out_sec
     return 0;
 }
 
+/* Next sector of a directory; follows the cluster chain, 0 at the end */
+static uint32_t dir_next_sector(uint32_t sector) {
+    /* The FAT12/16 root directory is contiguous */
+    if (sector < fat_state.data_start_sector) return sector + 1;
+
+    uint32_t rel = sector - fat_state.data_start_sector;
+    if ((rel + 1) % fat_state.sectors_per_cluster != 0) return sector + 1;
+
+    uint32_t next = fat_get_entry(rel / fat_state.sectors_per_cluster + 2);
+    if (next < 2 || next >= 0x0FFFFFF8) return 0;
+    return cluster_to_sector(next);
+}
+
 static int create_lfn_entries(uint32_t dir_cluster, const char* name,
                               const char* short_name, uint32_t* entry_sector, int* entry_index) {
     int name_len = strlen(name);
@@ -1056,7 +1953,8 @@ static int create_lfn_entries(uint32_t dir_cluster, const char* name,
         current_index++;
         if (current_index >= (int)entries_per_sec) {
             current_index = 0;
-            current_sector++;
+            current_sector = dir_next_sector(current_sector);
+            if (current_sector == 0) return -1;
         }
     }
 
@@ -1082,7 +1980,7 @@ static int is_valid_name(const char* name) {
     return 1;
 }
 
-int fat_touch(const char* path) {
+static int do_touch(const char* path) {
     if (!fat_state.mounted) {
         vga_print_color("No filesystem mounted\n", LIGHT_RED);
         return -1;
@@ -1167,237 +2065,18 @@ int fat_touch(const char* path) {
 
     if (write_sector(entry_sector, fat_state.sector_buf) < 0) return -1;
 
+    fat_dcache_invalidate_name(parent_cluster, filename);
+
     return 0;
 }
 
-int fat_write(const char* path, const void* data, uint32_t size) {
-    if (!fat_state.mounted) {
-        vga_print_color("No filesystem mounted\n", LIGHT_RED);
-        return -1;
-    }
-
-    fat_dir_entry_t entry;
-    uint32_t dummy;
-    int file_exists = (fat_resolve_path(path, &dummy, &entry) == 0);
-
-    if (file_exists && (entry.attr & FAT_ATTR_DIRECTORY)) {
-        vga_print_color("Cannot write to directory\n", LIGHT_RED);
-        return -1;
-    }
-
-    if (!file_exists) {
-        if (fat_touch(path) < 0) {
-            return -1;
-        }
-        if (fat_resolve_path(path, &dummy, &entry) < 0) {
-            vga_print_color("Failed to create file\n", LIGHT_RED);
-            return -1;
-        }
-    }
-
-    uint32_t old_cluster = get_entry_cluster(&entry);
-    while (old_cluster >= 2 && old_cluster < 0x0FFFFFF8) {
-        uint32_t next = fat_get_entry(old_cluster);
-        fat_set_entry(old_cluster, 0);
-        old_cluster = next;
-    }
-
-    if (fat_state.fat_cache_dirty) {
-        write_sector(fat_state.fat_cache_sector, fat_state.fat_cache);
-        fat_state.fat_cache_dirty = 0;
-    }
-
-    if (size == 0) {
-        char parent_path[FAT_MAX_PATH];
-        char filename[FAT_MAX_NAME];
-
-        strncpy(parent_path, path, FAT_MAX_PATH - 1);
-        char* last_slash = strrchr(parent_path, '/');
-        if (last_slash) {
-            strcpy(filename, last_slash + 1);
-            if (last_slash == parent_path) parent_path[1] = '\0';
-            else *last_slash = '\0';
-        } else {
-            strcpy(filename, path);
-            strcpy(parent_path, ".");
-        }
-
-        uint32_t parent_cluster;
-        if (strcmp(parent_path, ".") == 0) {
-            parent_cluster = fat_state.current_cluster;
-        } else if (strcmp(parent_path, "/") == 0) {
-            parent_cluster = (fat_state.type == FAT_TYPE_32) ? fat_state.root_cluster : 0;
-        } else {
-            fat_dir_entry_t pentry;
-            fat_resolve_path(parent_path, &parent_cluster, &pentry);
-        }
-
-        char fat_name[11];
-        str_to_fat_name(filename, fat_name);
-        uint16_t entries_per_sec = fat_state.entries_per_sector;
-
-        if (parent_cluster == 0 && fat_state.type != FAT_TYPE_32) {
-            for (uint32_t s = 0; s < fat_state.root_dir_sectors; s++) {
-                read_sector(fat_state.root_dir_sector + s, fat_state.sector_buf);
-                fat_dir_entry_t* entries = (fat_dir_entry_t*)fat_state.sector_buf;
-
-                for (uint16_t i = 0; i < entries_per_sec; i++) {
-                    if (memcmp(entries[i].name, fat_name, 11) == 0) {
-                        entries[i].cluster_lo = 0;
-                        entries[i].cluster_hi = 0;
-                        entries[i].file_size = 0;
-                        write_sector(fat_state.root_dir_sector + s, fat_state.sector_buf);
-                        return 0;
-                    }
-                }
-            }
-        } else {
-            uint32_t cluster = parent_cluster;
-            while (cluster < 0x0FFFFFF8) {
-                uint32_t sector = cluster_to_sector(cluster);
-
-                for (int s = 0; s < fat_state.sectors_per_cluster; s++) {
-                    read_sector(sector + s, fat_state.sector_buf);
-                    fat_dir_entry_t* entries = (fat_dir_entry_t*)fat_state.sector_buf;
-
-                    for (uint16_t i = 0; i < entries_per_sec; i++) {
-                        if (memcmp(entries[i].name, fat_name, 11) == 0) {
-                            entries[i].cluster_lo = 0;
-                            entries[i].cluster_hi = 0;
-                            entries[i].file_size = 0;
-                            write_sector(sector + s, fat_state.sector_buf);
-                            return 0;
-                        }
-                    }
-                }
-                cluster = fat_get_entry(cluster);
-            }
-        }
-        return 0;
-    }
-
-    uint32_t first_cluster = 0;
-    uint32_t prev_cluster = 0;
-    uint32_t bytes_written = 0;
-    const uint8_t* src = (const uint8_t*)data;
-    uint16_t bps = fat_state.bytes_per_sector;
-
-    while (bytes_written < size) {
-        uint32_t cluster = fat_alloc_cluster();
-        if (cluster == 0) {
-            if (first_cluster != 0) {
-                uint32_t c = first_cluster;
-                while (c >= 2 && c < 0x0FFFFFF8) {
-                    uint32_t next = fat_get_entry(c);
-                    fat_set_entry(c, 0);
-                    c = next;
-                }
-                if (fat_state.fat_cache_dirty) {
-                    write_sector(fat_state.fat_cache_sector, fat_state.fat_cache);
-                    fat_state.fat_cache_dirty = 0;
-                }
-            }
-            if (!file_exists) {
-                fat_rm(path);
-            }
-            vga_print_color("Disk full\n", LIGHT_RED);
-            return -1;
-        }
-
-        if (first_cluster == 0) first_cluster = cluster;
-        if (prev_cluster != 0) {
-            fat_set_entry(prev_cluster, cluster);
-        }
-        prev_cluster = cluster;
-
-        uint32_t sector = cluster_to_sector(cluster);
-        for (int s = 0; s < fat_state.sectors_per_cluster && bytes_written < size; s++) {
-            uint32_t chunk = size - bytes_written;
-            if (chunk > bps) chunk = bps;
-
-            memset(fat_state.sector_buf, 0, bps);
-            memcpy(fat_state.sector_buf, src + bytes_written, chunk);
-
-            if (write_sector(sector + s, fat_state.sector_buf) < 0) return -1;
-            bytes_written += bps;
-        }
-    }
-
-    if (fat_state.fat_cache_dirty) {
-        write_sector(fat_state.fat_cache_sector, fat_state.fat_cache);
-        fat_state.fat_cache_dirty = 0;
-    }
-
-    char parent_path[FAT_MAX_PATH];
-    char filename[FAT_MAX_NAME];
-
-    strncpy(parent_path, path, FAT_MAX_PATH - 1);
-    char* last_slash = strrchr(parent_path, '/');
-    if (last_slash) {
-        strcpy(filename, last_slash + 1);
-        if (last_slash == parent_path) parent_path[1] = '\0';
-        else *last_slash = '\0';
-    } else {
-        strcpy(filename, path);
-        strcpy(parent_path, ".");
-    }
-
-    uint32_t parent_cluster;
-    if (strcmp(parent_path, ".") == 0) {
-        parent_cluster = fat_state.current_cluster;
-    } else if (strcmp(parent_path, "/") == 0) {
-        parent_cluster = (fat_state.type == FAT_TYPE_32) ? fat_state.root_cluster : 0;
-    } else {
-        fat_dir_entry_t pentry;
-        fat_resolve_path(parent_path, &parent_cluster, &pentry);
-    }
-
-    char fat_name[11];
-    str_to_fat_name(filename, fat_name);
-    uint16_t entries_per_sec = fat_state.entries_per_sector;
-
-    if (parent_cluster == 0 && fat_state.type != FAT_TYPE_32) {
-        for (uint32_t s = 0; s < fat_state.root_dir_sectors; s++) {
-            read_sector(fat_state.root_dir_sector + s, fat_state.sector_buf);
-            fat_dir_entry_t* entries = (fat_dir_entry_t*)fat_state.sector_buf;
-
-            for (uint16_t i = 0; i < entries_per_sec; i++) {
-                if (memcmp(entries[i].name, fat_name, 11) == 0) {
-                    entries[i].cluster_lo = first_cluster & 0xFFFF;
-                    entries[i].cluster_hi = (first_cluster >> 16) & 0xFFFF;
-                    entries[i].file_size = size;
-                    write_sector(fat_state.root_dir_sector + s, fat_state.sector_buf);
-                    return 0;
-                }
-            }
-        }
-    } else {
-        uint32_t cluster = parent_cluster;
-        while (cluster < 0x0FFFFFF8) {
-            uint32_t sector = cluster_to_sector(cluster);
-
-            for (int s = 0; s < fat_state.sectors_per_cluster; s++) {
-                read_sector(sector + s, fat_state.sector_buf);
-                fat_dir_entry_t* entries = (fat_dir_entry_t*)fat_state.sector_buf;
-
-                for (uint16_t i = 0; i < entries_per_sec; i++) {
-                    if (memcmp(entries[i].name, fat_name, 11) == 0) {
-                        entries[i].cluster_lo = first_cluster & 0xFFFF;
-                        entries[i].cluster_hi = (first_cluster >> 16) & 0xFFFF;
-                        entries[i].file_size = size;
-                        write_sector(sector + s, fat_state.sector_buf);
-                        return 0;
-                    }
-                }
-            }
-            cluster = fat_get_entry(cluster);
-        }
-    }
-
-    return 0;
+int fat_touch(const char* path) {
+    int result = do_touch(path);
+    if (fat_state.mounted && fat_commit() < 0) result = -1;
+    return result;
 }
 
-int fat_mkdir(const char* path) {
+static int do_mkdir(const char* path) {
     if (!fat_state.mounted) {
         vga_print_color("No filesystem mounted\n", LIGHT_RED);
         return -1;
@@ -1481,20 +2160,12 @@ int fat_mkdir(const char* path) {
     if (needs_lfn(dirname)) {
         if (create_lfn_entries(parent_cluster, dirname, short_name, &entry_sector, &entry_index) < 0) {
             fat_set_entry(new_cluster, 0);
-            if (fat_state.fat_cache_dirty) {
-                write_sector(fat_state.fat_cache_sector, fat_state.fat_cache);
-                fat_state.fat_cache_dirty = 0;
-            }
             vga_print_color("Directory full or disk full\n", LIGHT_RED);
             return -1;
         }
     } else {
         if (find_empty_entries(parent_cluster, 1, &entry_sector, &entry_index) < 0) {
             fat_set_entry(new_cluster, 0);
-            if (fat_state.fat_cache_dirty) {
-                write_sector(fat_state.fat_cache_sector, fat_state.fat_cache);
-                fat_state.fat_cache_dirty = 0;
-            }
             vga_print_color("Directory full or disk full\n", LIGHT_RED);
             return -1;
         }
@@ -1511,10 +2182,19 @@ int fat_mkdir(const char* path) {
 
     write_sector(entry_sector, fat_state.sector_buf);
 
+    fat_dcache_invalidate_name(parent_cluster, dirname);
+    fat_dcache_invalidate_parent(new_cluster);
+
     return 0;
 }
 
-int fat_rm(const char* path) {
+int fat_mkdir(const char* path) {
+    int result = do_mkdir(path);
+    if (fat_state.mounted && fat_commit() < 0) result = -1;
+    return result;
+}
+
+static int do_rm(const char* path) {
     if (!fat_state.mounted) {
         vga_print_color("No filesystem mounted\n", LIGHT_RED);
         return -1;
@@ -1553,59 +2233,295 @@ int fat_rm(const char* path) {
         return -1;
     }
 
-    uint32_t cluster = get_entry_cluster(&entry);
-    while (cluster >= 2 && cluster < 0x0FFFFFF8) {
-        uint32_t next = fat_get_entry(cluster);
-        fat_set_entry(cluster, 0);
-        cluster = next;
+    uint32_t entry_sector = fat_state.found_sector;
+    uint16_t entry_index = fat_state.found_index;
+
+    if (fat_handle_busy(entry_sector, entry_index)) {
+        vga_print_color("File is in use\n", LIGHT_RED);
+        return -1;
     }
 
-    if (fat_state.fat_cache_dirty) {
-        write_sector(fat_state.fat_cache_sector, fat_state.fat_cache);
-        fat_state.fat_cache_dirty = 0;
+    fat_handle_forget(entry_sector, entry_index);
+    fat_dcache_invalidate_name(parent_cluster, name);
+    if (entry.attr & FAT_ATTR_DIRECTORY) {
+        fat_dcache_invalidate_parent(get_entry_cluster(&entry));
     }
+    fat_free_chain(get_entry_cluster(&entry));
 
-    char fat_name[11];
-    str_to_fat_name(name, fat_name);
-    uint16_t entries_per_sec = fat_state.entries_per_sector;
+    if (read_sector(entry_sector, fat_state.sector_buf) < 0) return -1;
+    ((fat_dir_entry_t*)fat_state.sector_buf)[entry_index].name[0] = 0xE5;
+    if (write_sector(entry_sector, fat_state.sector_buf) < 0) return -1;
 
-    if (parent_cluster == 0 && fat_state.type != FAT_TYPE_32) {
-        for (uint32_t s = 0; s < fat_state.root_dir_sectors; s++) {
-            read_sector(fat_state.root_dir_sector + s, fat_state.sector_buf);
-            fat_dir_entry_t* entries = (fat_dir_entry_t*)fat_state.sector_buf;
+    return 0;
+}
 
-            for (uint16_t i = 0; i < entries_per_sec; i++) {
-                if (memcmp(entries[i].name, fat_name, 11) == 0) {
-                    entries[i].name[0] = 0xE5;
-                    write_sector(fat_state.root_dir_sector + s, fat_state.sector_buf);
-                    return 0;
-                }
-            }
+int fat_rm(const char* path) {
+    int result = do_rm(path);
+    if (fat_state.mounted && fat_commit() < 0) result = -1;
+    return result;
+}
+
+static int do_open(const char* path, int flags) {
+    if (!fat_state.mounted) return -1;
+
+    fat_dir_entry_t entry;
+    uint32_t sector;
+    uint16_t index;
+
+    if (fat_lookup(path, &entry, &sector, &index) < 0) {
+        if (!(flags & FAT_O_CREATE)) return -1;
+        if (do_touch(path) < 0) return -1;
+        if (fat_lookup(path, &entry, &sector, &index) < 0) return -1;
+    }
+
+    if (entry.attr & FAT_ATTR_DIRECTORY) return -1;
+    /* A writer keeps its own size and chain: a second handle would lose them on close */
+    if ((flags & (FAT_O_WRITE | FAT_O_TRUNC)) && fat_handle_busy(sector, index)) return -1;
+
+    int fd = -1;
+    for (int i = 0; i < FAT_MAX_OPEN_FILES; i++) {
+        if (!fat_handles[i].used) {
+            fd = i;
+            break;
         }
-    } else {
-        cluster = parent_cluster;
-        while (cluster < 0x0FFFFFF8) {
-            uint32_t sector = cluster_to_sector(cluster);
-
-            for (int s = 0; s < fat_state.sectors_per_cluster; s++) {
-                read_sector(sector + s, fat_state.sector_buf);
-                fat_dir_entry_t* entries = (fat_dir_entry_t*)fat_state.sector_buf;
-
-                for (uint16_t i = 0; i < entries_per_sec; i++) {
-                    if (memcmp(entries[i].name, fat_name, 11) == 0) {
-                        entries[i].name[0] = 0xE5;
-                        write_sector(sector + s, fat_state.sector_buf);
-                        return 0;
-                    }
-                }
-            }
-            cluster = fat_get_entry(cluster);
+    }
+    if (fd < 0) return -1;
+
+    fat_handle_t* h = &fat_handles[fd];
+    memset(h, 0, sizeof(fat_handle_t));
+    h->used = 1;
+    h->flags = (uint8_t)flags;
+    h->entry_sector = sector;
+    h->entry_index = index;
+    h->first_cluster = get_entry_cluster(&entry);
+    h->size = entry.file_size;
+
+    if (flags & FAT_O_WRITE) {
+        if (flags & FAT_O_TRUNC) fat_handle_truncate(h);
+        else fat_handle_scan_chain(h);
+    }
+
+    return fd;
+}
+
+static int do_close(int fd) {
+    fat_handle_t* h = fat_handle_get(fd);
+    if (!h) return -1;
+
+    int result = fat_handle_store(h);
+    if (h->flags & FAT_O_WRITE) fat_tail_remember(h);
+    h->used = 0;
+    return result;
+}
+
+int fat_open(const char* path, int flags) {
+    return do_open(path, flags);
+}
+
+int fat_close(int fd) {
+    fat_handle_t* h = fat_handle_get(fd);
+    if (!h) return -1;
+
+    int writer = h->flags & FAT_O_WRITE;
+    int result = do_close(fd);
+    if (writer && fat_commit() < 0) result = -1;
+    return result;
+}
+
+int fat_pread(int fd, void* buffer, uint32_t size, uint32_t offset) {
+    fat_handle_t* h = fat_handle_get(fd);
+    if (!h || !(h->flags & FAT_O_READ)) return -1;
+    return fat_handle_read(h, (uint8_t*)buffer, size, offset);
+}
+
+int fat_pwrite(int fd, const void* data, uint32_t size, uint32_t offset) {
+    fat_handle_t* h = fat_handle_get(fd);
+    if (!h || !(h->flags & FAT_O_WRITE)) return -1;
+    return fat_handle_write(h, (const uint8_t*)data, size, offset);
+}
+
+int fat_fread(int fd, void* buffer, uint32_t size) {
+    fat_handle_t* h = fat_handle_get(fd);
+    if (!h) return -1;
+
+    int got = fat_pread(fd, buffer, size, h->pos);
+    if (got > 0) h->pos += (uint32_t)got;
+    return got;
+}
+
+int fat_fwrite(int fd, const void* data, uint32_t size) {
+    fat_handle_t* h = fat_handle_get(fd);
+    if (!h) return -1;
+
+    int put = fat_pwrite(fd, data, size, h->pos);
+    if (put > 0) h->pos += (uint32_t)put;
+    return put;
+}
+
+int fat_seek(int fd, int32_t offset, int whence) {
+    fat_handle_t* h = fat_handle_get(fd);
+    if (!h) return -1;
+
+    int64_t base;
+    switch (whence) {
+        case FAT_SEEK_SET: base = 0; break;
+        case FAT_SEEK_CUR: base = h->pos; break;
+        case FAT_SEEK_END: base = h->size; break;
+        default: return -1;
+    }
+
+    int64_t pos = base + offset;
+    if (pos < 0 || pos > 0x7FFFFFFF) return -1;
+
+    h->pos = (uint32_t)pos;
+    return (int)h->pos;
+}
+
+int fat_fsize(int fd) {
+    fat_handle_t* h = fat_handle_get(fd);
+    if (!h) return -1;
+    return (int)h->size;
+}
+
+int fat_read(const char* path, void* buffer, uint32_t max_size) {
+    int fd = do_open(path, FAT_O_READ);
+    if (fd < 0) return -1;
+
+    int got = fat_handle_read(&fat_handles[fd], (uint8_t*)buffer, max_size, 0);
+    do_close(fd);
+    return got;
+}
+
+static int do_write(const char* path, const void* data, uint32_t size) {
+    if (!fat_state.mounted) {
+        vga_print_color("No filesystem mounted\n", LIGHT_RED);
+        return -1;
+    }
+
+    fat_dir_entry_t entry;
+    uint32_t dummy;
+    int file_exists = (fat_resolve_path(path, &dummy, &entry) == 0);
+
+    if (file_exists && (entry.attr & FAT_ATTR_DIRECTORY)) {
+        vga_print_color("Cannot write to directory\n", LIGHT_RED);
+        return -1;
+    }
+
+    if (file_exists && fat_handle_busy(fat_state.found_sector, fat_state.found_index)) {
+        vga_print_color("File is in use\n", LIGHT_RED);
+        return -1;
+    }
+
+    if (!file_exists && do_touch(path) < 0) {
+        return -1;
+    }
+
+    int fd = do_open(path, FAT_O_WRITE | FAT_O_TRUNC);
+    if (fd < 0) {
+        vga_print_color("Failed to create file\n", LIGHT_RED);
+        return -1;
+    }
+
+    if (fat_handle_write(&fat_handles[fd], (const uint8_t*)data, size, 0) < 0) {
+        do_close(fd);
+        if (!file_exists) {
+            do_rm(path);
         }
+        vga_print_color("Disk full\n", LIGHT_RED);
+        return -1;
+    }
+
+    return do_close(fd);
+}
+
+int fat_write(const char* path, const void* data, uint32_t size) {
+    int result = do_write(path, data, size);
+    if (fat_state.mounted && fat_commit() < 0) result = -1;
+    return result;
+}
+
+static int do_append(const char* path, const void* data, uint32_t size) {
+    if (!fat_state.mounted) {
+        vga_print_color("No filesystem mounted\n", LIGHT_RED);
+        return -1;
+    }
+
+    int fd = do_open(path, FAT_O_WRITE | FAT_O_CREATE);
+    if (fd < 0) {
+        vga_print_color("Cannot open file for append\n", LIGHT_RED);
+        return -1;
     }
 
+    fat_handle_t* h = &fat_handles[fd];
+    if (fat_handle_write(h, (const uint8_t*)data, size, h->size) < 0) {
+        do_close(fd);
+        vga_print_color("Disk full\n", LIGHT_RED);
+        return -1;
+    }
+
+    return do_close(fd);
+}
+
+int fat_append(const char* path, const void* data, uint32_t size) {
+    int result = do_append(path, data, size);
+    if (fat_state.mounted && fat_commit() < 0) result = -1;
+    return result;
+}
+
+int fat_stat(const char* path, fat_file_info_t* info) {
+    if (!fat_state.mounted) return -1;
+
+    fat_dir_entry_t entry;
+    uint32_t cluster;
+    if (fat_resolve_path(path, &cluster, &entry) < 0) return -1;
+
+    memset(info, 0, sizeof(fat_file_info_t));
+
+    if (fat_state.found_sector == 0) {
+        /* Root directory has no entry of its own */
+        strcpy(info->name, "/");
+        info->attr = FAT_ATTR_DIRECTORY;
+        info->cluster = cluster;
+        return 0;
+    }
+
+    strncpy(info->name, fat_state.found_name, FAT_MAX_NAME - 1);
+    info->attr = entry.attr;
+    info->size = entry.file_size;
+    info->cluster = get_entry_cluster(&entry);
+    info->date = entry.modify_date;
+    info->time = entry.modify_time;
     return 0;
 }
 
+/* Both sizes are in KB so volumes over 4 GB do not overflow */
+static uint32_t fat_clusters_to_kb(uint32_t clusters) {
+    uint32_t cluster_bytes = (uint32_t)fat_state.sectors_per_cluster * fat_state.bytes_per_sector;
+    if (cluster_bytes < 1024) return clusters / (1024 / cluster_bytes);
+    return clusters * (cluster_bytes / 1024);
+}
+
+uint32_t fat_free_space(void) {
+    if (!fat_state.mounted) return 0;
+
+    if (fat_state.free_clusters == FAT_FREE_UNKNOWN) {
+        /* Only without an in-memory FAT or FSInfo: count once, then maintain */
+        uint32_t free_count = 0;
+        for (uint32_t c = 2; c < fat_state.total_clusters + 2; c++) {
+            if (fat_get_entry(c) == 0) free_count++;
+        }
+        fat_state.free_clusters = free_count;
+        fat_state.fsinfo_dirty = 1;
+    }
+
+    return fat_clusters_to_kb(fat_state.free_clusters);
+}
+
+uint32_t fat_total_space(void) {
+    if (!fat_state.mounted) return 0;
+    return fat_clusters_to_kb(fat_state.total_clusters);
+}
+
 void fat_info(void) {
     if (!fat_state.mounted) {
         vga_print_color("No filesystem mounted\n", LIGHT_RED);
@@ -1639,12 +2555,25 @@ void fat_info(void) {
     vga_print(buf);
     vga_putc('\n');
 
-    uint32_t cluster_bytes = fat_state.sectors_per_cluster * fat_state.bytes_per_sector;
-    uint32_t total_mb = (fat_state.total_clusters * cluster_bytes) / (1024 * 1024);
     vga_print_color("Total Size: ", 0x0F);
-    itoa(total_mb, buf, 10);
+    itoa(fat_total_space() / 1024, buf, 10);
+    vga_print(buf);
+    vga_print_color(" MB\n", 0x0F);
+
+    vga_print_color("Free Space: ", 0x0F);
+    itoa(fat_free_space() / 1024, buf, 10);
     vga_print(buf);
     vga_print_color(" MB\n", 0x0F);
+
+    fat_dcache_stats_t dc;
+    fat_dcache_get_stats(&dc);
+    vga_print_color("Lookup cache: ", 0x0F);
+    itoa(dc.hits + dc.negative_hits, buf, 10);
+    vga_print(buf);
+    vga_print_color(" hits, ", 0x0F);
+    itoa(dc.misses, buf, 10);
+    vga_print(buf);
+    vga_print_color(" misses\n", 0x0F);
 }
 
 int fat_exists(const char* path) {
@@ -23,6 +23,17 @@ typedef enum {
 #define FAT_MAX_PATH    256
 #define FAT_MAX_NAME    256
 
+#define FAT_MAX_OPEN_FILES  16
+
+#define FAT_O_READ      0x01
+#define FAT_O_WRITE     0x02
+#define FAT_O_CREATE    0x04
+#define FAT_O_TRUNC     0x08
+
+#define FAT_SEEK_SET    0
+#define FAT_SEEK_CUR    1
+#define FAT_SEEK_END    2
+
 typedef struct {
     char        name[FAT_MAX_NAME];
     uint8_t     attr;
@@ -35,6 +46,7 @@ typedef struct {
 int fat_mount(uint8_t drive);
 void fat_unmount(void);
 int fat_is_mounted(void);
+int fat_get_drive(void);     /* Mounted drive, -1 if none */
 
 fat_type_t fat_get_type(void);
 const char* fat_get_type_str(void);
@@ -55,6 +67,20 @@ int fat_stat(const char* path, fat_file_info_t* info);
 int fat_exists(const char* path);
 int fat_is_dir(const char* path);
 
+/*
+ * File handles. Reads and writes cost only the bytes touched; size and
+ * first-cluster changes reach the directory entry when the handle is closed.
+ * A file that already has an open handle cannot be opened for writing.
+ */
+int fat_open(const char* path, int flags);
+int fat_close(int fd);
+int fat_pread(int fd, void* buffer, uint32_t size, uint32_t offset);
+int fat_pwrite(int fd, const void* data, uint32_t size, uint32_t offset);
+int fat_fread(int fd, void* buffer, uint32_t size);
+int fat_fwrite(int fd, const void* data, uint32_t size);
+int fat_seek(int fd, int32_t offset, int whence);
+int fat_fsize(int fd);
+
 uint32_t fat_free_space(void);
 uint32_t fat_total_space(void);
 
@@ -0,0 +1,163 @@
+#include "fat_dcache.h"
+#include "../../utils/string.h"
+
+#define FAT_DCACHE_ENTRY_SIZE   32
+
+typedef struct {
+    uint8_t     valid;
+    uint8_t     negative;
+    uint16_t    index;
+    uint32_t    parent;
+    uint32_t    hash;
+    uint32_t    sector;
+    uint32_t    stamp;          /* Last use, for LRU within a set */
+    uint8_t     entry[FAT_DCACHE_ENTRY_SIZE];
+    char        name[FAT_DCACHE_NAME_MAX];
+} fat_dcache_slot_t;
+
+static fat_dcache_slot_t dcache[FAT_DCACHE_SETS][FAT_DCACHE_WAYS];
+static uint32_t dcache_clock = 0;
+static fat_dcache_stats_t dcache_stats;
+
+static char fold(char c) {
+    return (c >= 'a' && c <= 'z') ? (char)(c - 32) : c;
+}
+
+/* FNV-1a over the upper-cased name, mixed with the parent cluster */
+static uint32_t dcache_hash(uint32_t parent, const char* name) {
+    uint32_t h = 2166136261u ^ (parent * 2654435761u);
+    while (*name) {
+        h ^= (uint8_t)fold(*name++);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int names_equal(const char* a, const char* b) {
+    while (*a && *b) {
+        if (fold(*a) != fold(*b)) return 0;
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+static fat_dcache_slot_t* dcache_find(uint32_t parent, const char* name, uint32_t hash) {
+    fat_dcache_slot_t* set = dcache[hash % FAT_DCACHE_SETS];
+    for (int w = 0; w < FAT_DCACHE_WAYS; w++) {
+        fat_dcache_slot_t* slot = &set[w];
+        if (slot->valid && slot->hash == hash && slot->parent == parent &&
+            names_equal(slot->name, name)) {
+            return slot;
+        }
+    }
+    return 0;
+}
+
+void fat_dcache_reset(void) {
+    memset(dcache, 0, sizeof(dcache));
+    dcache_clock = 0;
+}
+
+int fat_dcache_lookup(uint32_t parent, const char* name, void* entry,
+                      uint32_t* sector, uint16_t* index, char* disk_name) {
+    if (strlen(name) >= FAT_DCACHE_NAME_MAX) return FAT_DCACHE_MISS;
+
+    fat_dcache_slot_t* slot = dcache_find(parent, name, dcache_hash(parent, name));
+    if (!slot) {
+        dcache_stats.misses++;
+        return FAT_DCACHE_MISS;
+    }
+
+    slot->stamp = ++dcache_clock;
+
+    if (slot->negative) {
+        dcache_stats.negative_hits++;
+        return FAT_DCACHE_NEGATIVE;
+    }
+
+    memcpy(entry, slot->entry, FAT_DCACHE_ENTRY_SIZE);
+    *sector = slot->sector;
+    *index = slot->index;
+    strcpy(disk_name, slot->name);
+
+    dcache_stats.hits++;
+    return FAT_DCACHE_HIT;
+}
+
+void fat_dcache_insert(uint32_t parent, const char* name, const void* entry,
+                       uint32_t sector, uint16_t index, const char* disk_name) {
+    if (strlen(name) >= FAT_DCACHE_NAME_MAX) return;
+    if (disk_name && strlen(disk_name) >= FAT_DCACHE_NAME_MAX) return;
+
+    uint32_t hash = dcache_hash(parent, name);
+    fat_dcache_slot_t* slot = dcache_find(parent, name, hash);
+
+    if (!slot) {
+        fat_dcache_slot_t* set = dcache[hash % FAT_DCACHE_SETS];
+        slot = &set[0];
+        for (int w = 0; w < FAT_DCACHE_WAYS; w++) {
+            if (!set[w].valid) {
+                slot = &set[w];
+                break;
+            }
+            if (set[w].stamp < slot->stamp) slot = &set[w];
+        }
+    }
+
+    slot->valid = 1;
+    slot->parent = parent;
+    slot->hash = hash;
+    slot->stamp = ++dcache_clock;
+
+    if (entry) {
+        slot->negative = 0;
+        slot->sector = sector;
+        slot->index = index;
+        memcpy(slot->entry, entry, FAT_DCACHE_ENTRY_SIZE);
+        strcpy(slot->name, disk_name);
+    } else {
+        slot->negative = 1;
+        slot->sector = 0;
+        slot->index = 0;
+        strcpy(slot->name, name);
+    }
+
+    dcache_stats.inserts++;
+}
+
+void fat_dcache_invalidate_name(uint32_t parent, const char* name) {
+    fat_dcache_slot_t* slot = dcache_find(parent, name, dcache_hash(parent, name));
+    if (slot) {
+        slot->valid = 0;
+        dcache_stats.invalidations++;
+    }
+}
+
+void fat_dcache_invalidate_location(uint32_t sector, uint16_t index) {
+    for (int s = 0; s < FAT_DCACHE_SETS; s++) {
+        for (int w = 0; w < FAT_DCACHE_WAYS; w++) {
+            fat_dcache_slot_t* slot = &dcache[s][w];
+            if (slot->valid && !slot->negative && slot->sector == sector && slot->index == index) {
+                slot->valid = 0;
+                dcache_stats.invalidations++;
+            }
+        }
+    }
+}
+
+void fat_dcache_invalidate_parent(uint32_t parent) {
+    for (int s = 0; s < FAT_DCACHE_SETS; s++) {
+        for (int w = 0; w < FAT_DCACHE_WAYS; w++) {
+            fat_dcache_slot_t* slot = &dcache[s][w];
+            if (slot->valid && slot->parent == parent) {
+                slot->valid = 0;
+                dcache_stats.invalidations++;
+            }
+        }
+    }
+}
+
+void fat_dcache_get_stats(fat_dcache_stats_t* out) {
+    memcpy(out, &dcache_stats, sizeof(fat_dcache_stats_t));
+}
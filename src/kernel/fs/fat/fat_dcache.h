@@ -0,0 +1,45 @@
+#ifndef FAT_DCACHE_H
+#define FAT_DCACHE_H
+
+#include <stdint.h>
+
+/*
+ * Directory entry cache for FAT path lookup.
+ * Keyed by (parent directory cluster, case-folded name). Negative entries
+ * remember names that are known not to exist. Entries are raw 32-byte
+ * directory records plus the sector/index they live at.
+ */
+
+#define FAT_DCACHE_SETS         128
+#define FAT_DCACHE_WAYS         4
+#define FAT_DCACHE_NAME_MAX     64      /* Longer names are not cached */
+
+#define FAT_DCACHE_MISS         -1
+#define FAT_DCACHE_NEGATIVE     0
+#define FAT_DCACHE_HIT          1
+
+typedef struct {
+    uint32_t    hits;
+    uint32_t    negative_hits;
+    uint32_t    misses;
+    uint32_t    inserts;
+    uint32_t    invalidations;
+} fat_dcache_stats_t;
+
+void fat_dcache_reset(void);
+
+/* Returns FAT_DCACHE_HIT (outputs filled), FAT_DCACHE_NEGATIVE or FAT_DCACHE_MISS */
+int fat_dcache_lookup(uint32_t parent, const char* name, void* entry,
+                      uint32_t* sector, uint16_t* index, char* disk_name);
+
+/* entry == 0 records a negative entry */
+void fat_dcache_insert(uint32_t parent, const char* name, const void* entry,
+                       uint32_t sector, uint16_t index, const char* disk_name);
+
+void fat_dcache_invalidate_name(uint32_t parent, const char* name);
+void fat_dcache_invalidate_location(uint32_t sector, uint16_t index);
+void fat_dcache_invalidate_parent(uint32_t parent);
+
+void fat_dcache_get_stats(fat_dcache_stats_t* out);
+
+#endif
@@ -2,23 +2,34 @@
 #include "../../utils/string.h"
 #include "../../drivers/vga/vga.h"
 #include "../../sys/panic.h"
+#include "../../mm/kmalloc.h"
 #include "../../drivers/vga/colors.h"
 
 
-static fs_node fs_nodes[MAX_NODES];
-static int node_count = 0;
+/* Nodes come from their own slab cache, file contents from kmalloc */
+static kmem_cache_t* node_cache = NULL;
+static char no_content[1];
 
 fs_node* fs_root = NULL;
 fs_node* fs_current = NULL;
 char current_path[128] = "";
 
 static fs_node* create_node(const char* name, fs_type type, fs_node* parent) {
-    if (node_count >= MAX_NODES) {
-        panic("Filesystem", "too many nodes (node pool exhausted)", __func__);
+    if (!node_cache) node_cache = kmem_cache_create("fs_node", sizeof(fs_node));
+    if (!node_cache) return NULL;
+
+    fs_node* n = (fs_node*)kmem_cache_alloc(node_cache);
+    if (!n) return NULL;
+
+    n->content = no_content;
+    if (type == FS_FILE) {
+        n->content = (char*)kmalloc(MAX_FILE_SIZE);
+        if (!n->content) {
+            kmem_cache_free(node_cache, n);
+            return NULL;
+        }
     }
 
-    fs_node* n = &fs_nodes[node_count++];
-
     int i = 0;
     while (name[i] && i < MAX_NAME_LEN - 1) {
         n->name[i] = name[i];
@@ -34,6 +45,13 @@ static fs_node* create_node(const char* name, fs_type type, fs_node* parent) {
     return n;
 }
 
+/* Frees a node and everything below it */
+static void free_node(fs_node* n) {
+    for (int i = 0; i < n->child_count; i++) free_node(n->children[i]);
+    if (n->content != no_content) kfree(n->content);
+    kmem_cache_free(node_cache, n);
+}
+
 static fs_node* find_child(fs_node* dir, const char* name) {
     for (int i = 0; i < dir->child_count; i++)
         if (strcmp(dir->children[i]->name, name) == 0)
@@ -112,8 +130,9 @@ static void rtrim(char* str) {
 /* ======================= Public Functions ======================= */
 
 void fs_init(void) {
-    node_count = 0;
+    if (fs_root) free_node(fs_root);
     fs_root = create_node("", FS_DIR, NULL);
+    if (!fs_root) panic("Filesystem", "cannot allocate root node", __func__);
     strcpy(fs_root->name, "/");
     fs_current = fs_root;
     update_current_path();
@@ -220,7 +239,10 @@ int fs_mkdir(const char* path) {
     }
 
     fs_node* d = create_node(last, FS_DIR, parent);
-    if (!d) panic("Filesystem", "failed to create directory node", __func__);
+    if (!d) {
+        vga_print_color("Out of memory\n", LIGHT_RED);
+        return -1;
+    }
 
     parent->children[parent->child_count++] = d;
     return 0;
@@ -242,6 +264,15 @@ int fs_rm(const char* path) {
     if (!path || !path[0]) return -1;
     fs_node* node = resolve_path(path, fs_current);
     if (!node || node == fs_root) return -1;
+
+    /* The node is freed, so it must not be the current directory or above it */
+    for (fs_node* cur = fs_current; cur; cur = cur->parent) {
+        if (cur == node) {
+            vga_print_color("Cannot remove the current directory\n", LIGHT_RED);
+            return -1;
+        }
+    }
+
     fs_node* parent = node->parent;
     int idx = -1;
     for (int i = 0; i < parent->child_count; i++)
@@ -250,6 +281,7 @@ int fs_rm(const char* path) {
     for (int i = idx; i < parent->child_count - 1; i++)
         parent->children[i] = parent->children[i + 1];
     parent->child_count--;
+    free_node(node);
     return 0;
 }
 
@@ -273,7 +305,8 @@ int fs_touch(const char* path) {
 
     fs_node* f = create_node(segs[n-1], FS_FILE, parent);
     if (!f) {
-        panic("Filesystem", "failed to create file node", __func__);
+        vga_print_color("Out of memory\n", LIGHT_RED);
+        return -1;
     }
 
     parent->children[parent->child_count++] = f;
@@ -4,7 +4,6 @@
 #define MAX_NAME_LEN   32
 #define MAX_CHILDREN   64
 #define MAX_FILE_SIZE  16384
-#define MAX_NODES      256
 
 typedef enum { FS_FILE, FS_DIR } fs_type;
 
@@ -14,7 +13,7 @@ typedef struct fs_node {
     struct fs_node* parent;
     struct fs_node* children[MAX_CHILDREN];
     int             child_count;
-    char            content[MAX_FILE_SIZE];
+    char*           content;        /* MAX_FILE_SIZE bytes for files, "" for directories */
 } fs_node;
 
 
@@ -9,6 +9,9 @@
 #include "arch/i686/idt/idt.h"
 #include "arch/i686/pic/pic.h"
 #include "arch/i686/timer/timer.h"
+#include "arch/i686/paging/paging.h"
+#include "mm/pmm.h"
+#include "mm/kmalloc.h"
 
 
 
@@ -21,12 +24,18 @@ void tests()
 
 }
 
-void kernel_main(void)
+void kernel_main(uint32_t magic, multiboot_info_t* mbi)
 {
     pic_remap(32, 40);
     init_gdt();
     init_idt();
     init_timer(100);
+    pmm_init(magic, mbi);
+    kmalloc_init();
+
+    pmm_stats_t mem;
+    pmm_get_stats(&mem);
+    paging_init(mem.top);
     __asm__ __volatile__("sti");
 
     init_system_base();
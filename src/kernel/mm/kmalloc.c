@@ -0,0 +1,222 @@
+#include "kmalloc.h"
+#include "pmm.h"
+#include "../drivers/vga/vga.h"
+#include "../drivers/vga/colors.h"
+#include "../utils/string.h"
+
+#define KMEM_SLAB_MAGIC     0x51AB51AB
+#define KMEM_ALIGN          8
+#define KMEM_SIZE_CLASSES   7           // 16, 32, ... 1024
+
+// Заголовок слаба лежит в начале его страницы, за ним - объекты
+typedef struct kmem_slab {
+    uint32_t            magic;
+    kmem_cache_t*       cache;
+    struct kmem_slab*   next;
+    struct kmem_slab*   prev;
+    void*               free_list;      // Свободные объекты связаны через свои первые байты
+    uint32_t            inuse;
+} kmem_slab_t;
+
+#define KMEM_FIRST_OBJ      ((sizeof(kmem_slab_t) + 15) & ~15u)
+
+static kmem_cache_t caches[KMEM_MAX_CACHES];
+static int cache_count = 0;
+
+static kmem_cache_t* size_caches[KMEM_SIZE_CLASSES];
+static const char* const size_names[KMEM_SIZE_CLASSES] = {
+    "kmalloc-16", "kmalloc-32", "kmalloc-64", "kmalloc-128",
+    "kmalloc-256", "kmalloc-512", "kmalloc-1024",
+};
+static int kmalloc_ready = 0;
+
+static uint32_t large_allocs = 0;
+static uint32_t large_frees = 0;
+
+static inline kmem_slab_t* slab_of(const void* obj) {
+    return (kmem_slab_t*)((uintptr_t)obj & ~(uintptr_t)(PMM_PAGE_SIZE - 1));
+}
+
+static void slab_unlink(kmem_slab_t** list, kmem_slab_t* slab) {
+    if (slab->prev) slab->prev->next = slab->next;
+    else *list = slab->next;
+    if (slab->next) slab->next->prev = slab->prev;
+    slab->next = slab->prev = NULL;
+}
+
+static void slab_link(kmem_slab_t** list, kmem_slab_t* slab) {
+    slab->prev = NULL;
+    slab->next = *list;
+    if (*list) (*list)->prev = slab;
+    *list = slab;
+}
+
+// Список, в котором слаб должен лежать при текущем числе занятых объектов
+static kmem_slab_t** slab_list(kmem_cache_t* cache, kmem_slab_t* slab) {
+    if (slab->inuse == 0) return &cache->empty;
+    if (slab->inuse == cache->objs_per_slab) return &cache->full;
+    return &cache->partial;
+}
+
+static kmem_slab_t* slab_create(kmem_cache_t* cache) {
+    kmem_slab_t* slab = (kmem_slab_t*)pmm_alloc_pages(0, PMM_OWNER_HEAP);
+    if (!slab) return NULL;
+
+    slab->magic = KMEM_SLAB_MAGIC;
+    slab->cache = cache;
+    slab->next = slab->prev = NULL;
+    slab->inuse = 0;
+    slab->free_list = NULL;
+
+    // Список собирается с конца, чтобы объекты выдавались по возрастанию адресов
+    uint8_t* first = (uint8_t*)slab + KMEM_FIRST_OBJ;
+    for (uint32_t i = cache->objs_per_slab; i > 0; i--) {
+        void** obj = (void**)(first + (i - 1) * cache->obj_size);
+        *obj = slab->free_list;
+        slab->free_list = obj;
+    }
+
+    cache->slabs++;
+    return slab;
+}
+
+kmem_cache_t* kmem_cache_create(const char* name, uint32_t size) {
+    if (cache_count >= KMEM_MAX_CACHES || size == 0) return NULL;
+
+    size = (size + KMEM_ALIGN - 1) & ~(uint32_t)(KMEM_ALIGN - 1);
+    if (size < sizeof(void*)) size = sizeof(void*);
+    if (size > PMM_PAGE_SIZE - KMEM_FIRST_OBJ) return NULL;
+
+    kmem_cache_t* cache = &caches[cache_count++];
+    memset(cache, 0, sizeof(*cache));
+    cache->name = name;
+    cache->obj_size = size;
+    cache->objs_per_slab = (PMM_PAGE_SIZE - KMEM_FIRST_OBJ) / size;
+    return cache;
+}
+
+void* kmem_cache_alloc(kmem_cache_t* cache) {
+    kmem_slab_t* slab = cache->partial;
+    kmem_slab_t** list = &cache->partial;
+
+    if (!slab) {
+        slab = cache->empty;
+        list = &cache->empty;
+    }
+    if (!slab) {
+        slab = slab_create(cache);
+        if (!slab) {
+            cache->failures++;
+            return NULL;
+        }
+    } else {
+        slab_unlink(list, slab);
+    }
+
+    void** obj = (void**)slab->free_list;
+    slab->free_list = *obj;
+    slab->inuse++;
+    slab_link(slab_list(cache, slab), slab);
+
+    cache->active++;
+    cache->allocs++;
+    return obj;
+}
+
+void kmem_cache_free(kmem_cache_t* cache, void* obj) {
+    kmem_slab_t* slab = slab_of(obj);
+    uintptr_t offset = (uintptr_t)obj - (uintptr_t)slab;
+
+    if (slab->magic != KMEM_SLAB_MAGIC || slab->cache != cache || offset < KMEM_FIRST_OBJ ||
+        (offset - KMEM_FIRST_OBJ) % cache->obj_size != 0 || slab->inuse == 0) {
+        vga_print_color("kmem: bad free\n", LIGHT_RED);
+        return;
+    }
+
+    slab_unlink(slab_list(cache, slab), slab);
+
+    *(void**)obj = slab->free_list;
+    slab->free_list = obj;
+    slab->inuse--;
+    cache->active--;
+    cache->frees++;
+
+    // Один пустой слаб держим про запас, остальные отдаем обратно
+    if (slab->inuse == 0 && cache->empty) {
+        slab->magic = 0;
+        cache->slabs--;
+        pmm_free_pages(slab);
+        return;
+    }
+    slab_link(slab_list(cache, slab), slab);
+}
+
+void kmalloc_init(void) {
+    if (kmalloc_ready) return;
+    kmalloc_ready = 1;
+
+    for (int i = 0; i < KMEM_SIZE_CLASSES; i++) {
+        size_caches[i] = kmem_cache_create(size_names[i], KMALLOC_MIN_SIZE << i);
+    }
+}
+
+void* kmalloc(size_t size) {
+    if (size == 0) return NULL;
+    if (!kmalloc_ready) kmalloc_init();
+
+    if (size <= KMALLOC_MAX_SIZE) {
+        int i = 0;
+        while ((size_t)(KMALLOC_MIN_SIZE << i) < size) i++;
+        return kmem_cache_alloc(size_caches[i]);
+    }
+
+    // Крупные блоки выровнены по странице - так kfree отличает их от объектов слабов
+    uint32_t order = pmm_order_for_size((uint32_t)size);
+    if (order > PMM_MAX_ORDER) return NULL;
+
+    void* block = pmm_alloc_pages(order, PMM_OWNER_HEAP);
+    if (block) large_allocs++;
+    return block;
+}
+
+void* kzalloc(size_t size) {
+    void* ptr = kmalloc(size);
+    if (ptr) memset(ptr, 0, size);
+    return ptr;
+}
+
+void kfree(void* ptr) {
+    if (!ptr) return;
+
+    if (((uintptr_t)ptr & (PMM_PAGE_SIZE - 1)) == 0) {
+        large_frees++;
+        pmm_free_pages(ptr);
+        return;
+    }
+
+    kmem_slab_t* slab = slab_of(ptr);
+    if (slab->magic != KMEM_SLAB_MAGIC) {
+        vga_print_color("kfree: bad pointer\n", LIGHT_RED);
+        return;
+    }
+    kmem_cache_free(slab->cache, ptr);
+}
+
+int kmem_cache_count(void) {
+    return cache_count;
+}
+
+const kmem_cache_t* kmem_cache_get(int index) {
+    return (index >= 0 && index < cache_count) ? &caches[index] : NULL;
+}
+
+void kmalloc_large_stats(uint32_t* blocks, uint32_t* pages) {
+    pmm_stats_t st;
+    pmm_get_stats(&st);
+
+    uint32_t slab_pages = 0;
+    for (int i = 0; i < cache_count; i++) slab_pages += caches[i].slabs;
+
+    *blocks = large_allocs - large_frees;
+    *pages = st.owner_pages[PMM_OWNER_HEAP] - slab_pages;
+}
@@ -0,0 +1,47 @@
+#ifndef KMALLOC_H
+#define KMALLOC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Куча ядра: слабы для мелких объектов, крупные блоки - прямо страницами из PMM
+#define KMEM_MAX_CACHES     24
+#define KMALLOC_MIN_SIZE    16
+#define KMALLOC_MAX_SIZE    1024    // Больше - выделяется страницами (pmm_alloc_pages)
+
+struct kmem_slab;
+
+// Кэш объектов одного размера; слаб занимает одну страницу
+typedef struct {
+    const char*         name;
+    uint32_t            obj_size;
+    uint32_t            objs_per_slab;
+
+    struct kmem_slab*   partial;    // Есть и занятые, и свободные объекты
+    struct kmem_slab*   full;
+    struct kmem_slab*   empty;      // Не больше одного, остальные возвращаются в PMM
+
+    uint32_t            slabs;
+    uint32_t            active;     // Выданные объекты
+    uint32_t            allocs;
+    uint32_t            frees;
+    uint32_t            failures;   // PMM не дал страницу
+} kmem_cache_t;
+
+void kmalloc_init(void);
+
+// Создает кэш для объектов size байт; NULL если кэшей слишком много или объект больше слаба
+kmem_cache_t* kmem_cache_create(const char* name, uint32_t size);
+void* kmem_cache_alloc(kmem_cache_t* cache);
+void kmem_cache_free(kmem_cache_t* cache, void* obj);
+
+void* kmalloc(size_t size);
+void* kzalloc(size_t size);
+void kfree(void* ptr);
+
+// Для slabinfo
+int kmem_cache_count(void);
+const kmem_cache_t* kmem_cache_get(int index);
+void kmalloc_large_stats(uint32_t* blocks, uint32_t* pages);
+
+#endif
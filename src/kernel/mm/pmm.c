@@ -0,0 +1,260 @@
+#include "pmm.h"
+#include "../exec/elf.h"
+#include "../drivers/vga/vga.h"
+#include "../drivers/vga/colors.h"
+#include "../utils/string.h"
+
+#define PMM_MAX_REGIONS     32
+#define PMM_LOWMEM_END      0x100000
+#define PMM_FALLBACK_TOP    0x2000000   // 32 МБ, если загрузчик не передал размер памяти
+
+#define PMM_ORDER_NONE      0xFF        // Страница не является началом блока
+#define PMM_OWNER_NONE      0xFF        // Не RAM (дыра в карте памяти)
+
+// Состояние одной физической страницы; order/owner имеют смысл только у первой страницы блока
+typedef struct {
+    uint8_t     order;
+    uint8_t     owner;
+} pmm_frame_t;
+
+// Звено списка свободных блоков, хранится в самой свободной странице
+typedef struct pmm_block {
+    struct pmm_block*   next;
+    struct pmm_block*   prev;
+} pmm_block_t;
+
+typedef struct {
+    uint32_t    start;      // Номера страниц, [start, end)
+    uint32_t    end;
+} pmm_region_t;
+
+static pmm_region_t regions[PMM_MAX_REGIONS];
+static int region_count = 0;
+
+static pmm_frame_t* frames = 0;
+static uint32_t frame_count = 0;
+
+static pmm_block_t* free_lists[PMM_MAX_ORDER + 1];
+static pmm_stats_t stats;
+
+static const char* const owner_names[PMM_OWNER_COUNT] = {
+    "free", "low memory", "kernel", "programs", "ramdisk", "kernel heap",
+    "program heap", "page tables",
+};
+
+static inline void* pfn_to_addr(uint32_t pfn) {
+    return (void*)(pfn << PMM_PAGE_SHIFT);
+}
+
+static inline uint32_t addr_to_pfn(const void* addr) {
+    return (uint32_t)addr >> PMM_PAGE_SHIFT;
+}
+
+// Добавляет область RAM в байтах; всё выше 4 ГБ отбрасывается, края выравниваются внутрь
+static void add_region(uint64_t base, uint64_t len) {
+    if (region_count >= PMM_MAX_REGIONS || len == 0) return;
+    if (base >= 0x100000000ULL) return;
+
+    uint64_t end = base + len;
+    if (end > 0x100000000ULL) end = 0x100000000ULL;
+
+    uint32_t start_pfn = (uint32_t)((base + PMM_PAGE_SIZE - 1) >> PMM_PAGE_SHIFT);
+    uint32_t end_pfn = (uint32_t)(end >> PMM_PAGE_SHIFT);
+    if (end_pfn <= start_pfn) return;
+
+    regions[region_count].start = start_pfn;
+    regions[region_count].end = end_pfn;
+    region_count++;
+}
+
+static void collect_regions(uint32_t magic, const multiboot_info_t* mbi) {
+    if (magic == MULTIBOOT_BOOTLOADER_MAGIC && mbi && (mbi->flags & MULTIBOOT_INFO_MEM_MAP)) {
+        uint32_t addr = mbi->mmap_addr;
+        uint32_t end = mbi->mmap_addr + mbi->mmap_length;
+
+        while (addr < end) {
+            const multiboot_mmap_entry_t* e = (const multiboot_mmap_entry_t*)addr;
+            if (e->type == MULTIBOOT_MEMORY_AVAILABLE) add_region(e->addr, e->len);
+            addr += e->size + sizeof(e->size);
+        }
+
+        if (region_count > 0) {
+            stats.source = PMM_SOURCE_MMAP;
+            return;
+        }
+    }
+
+    if (magic == MULTIBOOT_BOOTLOADER_MAGIC && mbi && (mbi->flags & MULTIBOOT_INFO_MEMORY)) {
+        add_region(0, (uint64_t)mbi->mem_lower * 1024);
+        add_region(PMM_LOWMEM_END, (uint64_t)mbi->mem_upper * 1024);
+        stats.source = PMM_SOURCE_MEMINFO;
+        return;
+    }
+
+    add_region(PMM_LOWMEM_END, PMM_FALLBACK_TOP - PMM_LOWMEM_END);
+    stats.source = PMM_SOURCE_FALLBACK;
+}
+
+static void list_push(uint32_t pfn, uint32_t order) {
+    pmm_block_t* b = (pmm_block_t*)pfn_to_addr(pfn);
+    b->prev = 0;
+    b->next = free_lists[order];
+    if (b->next) b->next->prev = b;
+    free_lists[order] = b;
+
+    frames[pfn].order = (uint8_t)order;
+    frames[pfn].owner = PMM_OWNER_FREE;
+    stats.free_blocks[order]++;
+}
+
+static void list_remove(uint32_t pfn, uint32_t order) {
+    pmm_block_t* b = (pmm_block_t*)pfn_to_addr(pfn);
+    if (b->prev) b->prev->next = b->next;
+    else free_lists[order] = b->next;
+    if (b->next) b->next->prev = b->prev;
+
+    frames[pfn].order = PMM_ORDER_NONE;
+    stats.free_blocks[order]--;
+}
+
+static inline int is_free_head(uint32_t pfn, uint32_t order) {
+    return pfn < frame_count &&
+           frames[pfn].owner == PMM_OWNER_FREE &&
+           frames[pfn].order == order;
+}
+
+// Возвращает блок в списки, сливая его с освободившимися соседями-"близнецами"
+static void free_block(uint32_t pfn, uint32_t order) {
+    stats.free_pages += 1u << order;
+
+    while (order < PMM_MAX_ORDER) {
+        uint32_t buddy = pfn ^ (1u << order);
+        if (!is_free_head(buddy, order)) break;
+
+        list_remove(buddy, order);
+        pfn &= ~(1u << order);
+        order++;
+    }
+
+    list_push(pfn, order);
+}
+
+// Отдает аллокатору страницы [start, end) наибольшими выровненными блоками
+static void free_range(uint32_t start, uint32_t end) {
+    while (start < end) {
+        uint32_t order = 0;
+        while (order < PMM_MAX_ORDER &&
+               (start & ((2u << order) - 1)) == 0 &&
+               start + (2u << order) <= end) {
+            order++;
+        }
+        free_block(start, order);
+        start += 1u << order;
+    }
+}
+
+void pmm_init(uint32_t magic, const multiboot_info_t* mbi) {
+    extern char end;
+
+    memset(&stats, 0, sizeof(stats));
+    memset(free_lists, 0, sizeof(free_lists));
+    region_count = 0;
+
+    // Карту нужно прочитать до того, как страницы начнут раздаваться: она может лежать в RAM
+    collect_regions(magic, mbi);
+
+    uint32_t top_pfn = 0;
+    for (int i = 0; i < region_count; i++) {
+        if (regions[i].end > top_pfn) top_pfn = regions[i].end;
+        stats.total_pages += regions[i].end - regions[i].start;
+    }
+    stats.top = top_pfn << PMM_PAGE_SHIFT;
+
+    // Массив состояний страниц кладем сразу за ядром
+    uint32_t kernel_end = ((uint32_t)&end + PMM_PAGE_SIZE - 1) & ~(PMM_PAGE_SIZE - 1);
+    frames = (pmm_frame_t*)kernel_end;
+    frame_count = top_pfn;
+    memset(frames, PMM_OWNER_NONE, frame_count * sizeof(pmm_frame_t));
+
+    uint32_t kernel_end_pfn = (kernel_end + frame_count * sizeof(pmm_frame_t) + PMM_PAGE_SIZE - 1) >> PMM_PAGE_SHIFT;
+    stats.kernel_end = kernel_end_pfn << PMM_PAGE_SHIFT;
+
+    uint32_t reserved_end_pfn = SAFE_LOAD_MAX >> PMM_PAGE_SHIFT;
+    if (reserved_end_pfn < kernel_end_pfn) reserved_end_pfn = kernel_end_pfn;
+
+    // Всё ниже reserved_end_pfn занято постоянно: нижняя память, ядро, окно программ
+    for (int i = 0; i < region_count; i++) {
+        uint32_t start = regions[i].start;
+        uint32_t stop = regions[i].end;
+
+        for (; start < stop && start < reserved_end_pfn; start++) {
+            pmm_owner_t owner;
+            if (start < (PMM_LOWMEM_END >> PMM_PAGE_SHIFT)) owner = PMM_OWNER_LOWMEM;
+            else if (start < kernel_end_pfn) owner = PMM_OWNER_KERNEL;
+            else owner = PMM_OWNER_PROGRAMS;
+
+            frames[start].owner = (uint8_t)owner;
+            stats.owner_pages[owner]++;
+        }
+
+        if (start < stop) free_range(start, stop);
+    }
+}
+
+void* pmm_alloc_pages(uint32_t order, pmm_owner_t owner) {
+    if (order > PMM_MAX_ORDER || owner == PMM_OWNER_FREE || owner >= PMM_OWNER_COUNT) return 0;
+
+    uint32_t k = order;
+    while (k <= PMM_MAX_ORDER && !free_lists[k]) k++;
+    if (k > PMM_MAX_ORDER) return 0;
+
+    uint32_t pfn = addr_to_pfn(free_lists[k]);
+    list_remove(pfn, k);
+
+    // Лишние половины крупного блока возвращаются в списки меньших порядков
+    while (k > order) {
+        k--;
+        list_push(pfn + (1u << k), k);
+    }
+
+    frames[pfn].order = (uint8_t)order;
+    frames[pfn].owner = (uint8_t)owner;
+    stats.free_pages -= 1u << order;
+    stats.owner_pages[owner] += 1u << order;
+
+    return pfn_to_addr(pfn);
+}
+
+void pmm_free_pages(void* addr) {
+    uint32_t pfn = addr_to_pfn(addr);
+
+    if (!addr || ((uint32_t)addr & (PMM_PAGE_SIZE - 1)) || pfn >= frame_count ||
+        frames[pfn].order > PMM_MAX_ORDER || frames[pfn].owner == PMM_OWNER_FREE ||
+        frames[pfn].owner >= PMM_OWNER_COUNT) {
+        vga_print_color("pmm: bad free\n", LIGHT_RED);
+        return;
+    }
+
+    uint32_t order = frames[pfn].order;
+    stats.owner_pages[frames[pfn].owner] -= 1u << order;
+
+    frames[pfn].order = PMM_ORDER_NONE;
+    frames[pfn].owner = PMM_OWNER_FREE;
+    free_block(pfn, order);
+}
+
+uint32_t pmm_order_for_size(uint32_t size) {
+    uint32_t pages = (size + PMM_PAGE_SIZE - 1) >> PMM_PAGE_SHIFT;
+    uint32_t order = 0;
+    while (order <= PMM_MAX_ORDER && (1u << order) < pages) order++;
+    return order;
+}
+
+void pmm_get_stats(pmm_stats_t* out) {
+    *out = stats;
+    out->owner_pages[PMM_OWNER_FREE] = stats.free_pages;
+}
+
+const char* pmm_owner_name(pmm_owner_t owner) {
+    return owner < PMM_OWNER_COUNT ? owner_names[owner] : "?";
+}
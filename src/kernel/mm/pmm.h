@@ -0,0 +1,57 @@
+#ifndef PMM_H
+#define PMM_H
+
+#include <stdint.h>
+#include "../boot/multiboot.h"
+
+// Аллокатор физических страниц (buddy): блоки из 2^order страниц
+#define PMM_PAGE_SIZE   4096
+#define PMM_PAGE_SHIFT  12
+#define PMM_MAX_ORDER   10      // Самый крупный блок: 1024 страницы = 4 МБ
+
+// Кому принадлежат страницы (для meminfo)
+typedef enum {
+    PMM_OWNER_FREE = 0,
+    PMM_OWNER_LOWMEM,           // Всё ниже 1 МБ: BIOS, видеопамять, структуры загрузчика
+    PMM_OWNER_KERNEL,           // Образ ядра и карта страниц самого PMM
+    PMM_OWNER_PROGRAMS,         // Окно загрузки ELF (до SAFE_LOAD_MAX)
+    PMM_OWNER_RAMDISK,
+    PMM_OWNER_HEAP,             // kmalloc: слабы и крупные блоки
+    PMM_OWNER_PROGRAM_HEAP,     // malloc загруженных программ
+    PMM_OWNER_PAGING,           // Таблицы страниц
+    PMM_OWNER_COUNT
+} pmm_owner_t;
+
+// Откуда взята карта памяти
+typedef enum {
+    PMM_SOURCE_MMAP = 0,        // Карта памяти Multiboot
+    PMM_SOURCE_MEMINFO,         // Только mem_lower/mem_upper
+    PMM_SOURCE_FALLBACK,        // Загрузчик ничего не сообщил
+} pmm_source_t;
+
+typedef struct {
+    pmm_source_t    source;
+    uint32_t        total_pages;                    // Вся RAM из карты памяти
+    uint32_t        free_pages;
+    uint32_t        owner_pages[PMM_OWNER_COUNT];
+    uint32_t        free_blocks[PMM_MAX_ORDER + 1]; // Длина списка свободных блоков каждого порядка
+    uint32_t        top;                            // Конец самой старшей области RAM
+    uint32_t        kernel_end;                     // Конец ядра вместе с картой страниц PMM
+} pmm_stats_t;
+
+// Разбирает карту памяти и строит списки свободных блоков (EAX/EBX от загрузчика)
+void pmm_init(uint32_t magic, const multiboot_info_t* mbi);
+
+// Выделяет 2^order физически непрерывных страниц; NULL если нет памяти
+void* pmm_alloc_pages(uint32_t order, pmm_owner_t owner);
+
+// Возвращает блок, полученный от pmm_alloc_pages (порядок запомнен при выделении)
+void pmm_free_pages(void* addr);
+
+// Наименьший порядок, вмещающий size байт (PMM_MAX_ORDER + 1 если не влезает)
+uint32_t pmm_order_for_size(uint32_t size);
+
+void pmm_get_stats(pmm_stats_t* stats);
+const char* pmm_owner_name(pmm_owner_t owner);
+
+#endif
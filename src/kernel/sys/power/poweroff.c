@@ -1,11 +1,13 @@
 #include "../../drivers/vga/vga.h"
 #include "../../utils/ports.h"
 #include "../../drivers/vga/colors.h"
+#include "../../fs/bcache/bcache.h"
 #include "power.h"
 
 
 void do_poweroff(void) {
     vga_print_color("Shutting down...\n", LIGHT_RED);
+    bcache_sync(BCACHE_ALL_DRIVES);
     for (volatile int i = 0; i < 50000000; i++);
 
     asm volatile("cli");
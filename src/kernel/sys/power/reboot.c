@@ -1,12 +1,14 @@
 #include "../../drivers/vga/vga.h"
 #include "../../utils/ports.h"
 #include "../../drivers/vga/colors.h"
+#include "../../fs/bcache/bcache.h"
 
 #include "power.h"
 
 
 void do_reboot(void) {
     vga_print_color("Rebooting...\n", LIGHT_RED);
+    bcache_sync(BCACHE_ALL_DRIVES);
     for (volatile int i = 0; i < 50000000; i++);
     asm volatile("cli");
     outb(0x64, 0xFE);
@@ -171,3 +171,18 @@ size_t strlen(const char *str) {
     while (*s) s++;
     return (size_t)(s - str);
 }
+
+/*
+    Читает десятичное число без знака с позиции p
+    Возвращает указатель на первый символ после числа или NULL, если там нет цифры
+ */
+const char* parse_number(const char* p, uint32_t* out) {
+    uint32_t value = 0;
+    if (*p < '0' || *p > '9') return NULL;
+    while (*p >= '0' && *p <= '9') {
+        value = value * 10 + (uint32_t)(*p - '0');
+        p++;
+    }
+    *out = value;
+    return p;
+}
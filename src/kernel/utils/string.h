@@ -2,6 +2,7 @@
 #define STRING_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 int strcmp(const char* a, const char* b);
 char* strncpy(char* dest, const char* src, size_t n);
@@ -23,4 +24,5 @@ char* strrchr(const char* s, int c);
 char* strstr(const char* haystack, const char* needle);
 
 void itoa(int n, char *str, int base);
+const char* parse_number(const char* p, uint32_t* out);
 #endif
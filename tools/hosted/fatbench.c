@@ -0,0 +1,205 @@
+/*
+ * fatbench: micro-benchmarks for the FAT and memory_fs code on a host.
+ *
+ *   fatbench <image> [cycles]
+ *
+ * The image is attached as ATA drive 1 (as in `make run`) and mounted.
+ * Every test prints one key=value line; device command counts come from
+ * the image shim, so algorithmic changes show up even where wall time
+ * is dominated by the page cache.
+ */
+#include "hosted.h"
+#include "../../src/kernel/fs/fat/fat.h"
+#include "../../src/kernel/fs/bcache/bcache.h"
+#include "../../src/kernel/fs/memory_fs/fs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_DRIVE         1
+#define SMALL_FILES         32
+#define SMALL_SIZE          4096
+#define BIG_SIZE            (4 * 1024 * 1024)
+#define BIG_CHUNK           (64 * 1024)
+#define LOOKUPS             20000
+#define MEMFS_DIRS          4
+#define MEMFS_FILES         48
+
+static uint8_t small_buf[SMALL_SIZE];
+static uint8_t big_chunk[BIG_CHUNK];
+
+typedef struct {
+    const char*         name;
+    uint64_t            start_us;
+    hosted_io_stats_t   io;
+} bench_t;
+
+static void bench_start(bench_t* b, const char* name) {
+    b->name = name;
+    hosted_reset_io();
+    bcache_reset_stats();
+    b->start_us = hosted_now_us();
+}
+
+static void bench_stop(bench_t* b, uint64_t ops, uint64_t bytes) {
+    uint64_t us = hosted_now_us() - b->start_us;
+    if (us == 0) us = 1;
+    hosted_get_io(&b->io);
+
+    printf("fatbench test=%s ops=%llu bytes=%llu us=%llu", b->name,
+           (unsigned long long)ops, (unsigned long long)bytes, (unsigned long long)us);
+    if (bytes) printf(" kb_per_s=%llu", (unsigned long long)(bytes * 1000000 / 1024 / us));
+    else printf(" ops_per_s=%llu", (unsigned long long)(ops * 1000000 / us));
+    printf(" rcmd=%llu rsec=%llu wcmd=%llu wsec=%llu flush=%llu\n",
+           (unsigned long long)b->io.read_cmds, (unsigned long long)b->io.read_sectors,
+           (unsigned long long)b->io.write_cmds, (unsigned long long)b->io.write_sectors,
+           (unsigned long long)b->io.flushes);
+}
+
+static void small_path(char* out, int i) {
+    snprintf(out, 32, "/HBENCH/F%d.DAT", i);
+}
+
+static int bench_small_files(int cycles) {
+    bench_t b;
+    char path[32];
+
+    if (!fat_is_dir("/HBENCH") && fat_mkdir("/HBENCH") < 0) return -1;
+
+    bench_start(&b, "create_write");
+    for (int c = 0; c < cycles; c++) {
+        for (int i = 0; i < SMALL_FILES; i++) {
+            small_path(path, i);
+            small_buf[0] = (uint8_t)(c + i);
+            if (fat_write(path, small_buf, SMALL_SIZE) < 0) return -1;
+        }
+        if (c + 1 < cycles) {
+            for (int i = 0; i < SMALL_FILES; i++) {
+                small_path(path, i);
+                if (fat_rm(path) < 0) return -1;
+            }
+        }
+    }
+    bench_stop(&b, (uint64_t)cycles * SMALL_FILES, (uint64_t)cycles * SMALL_FILES * SMALL_SIZE);
+
+    bench_start(&b, "read_small");
+    for (int c = 0; c < cycles; c++) {
+        for (int i = 0; i < SMALL_FILES; i++) {
+            small_path(path, i);
+            if (fat_read(path, small_buf, SMALL_SIZE) != SMALL_SIZE) return -1;
+        }
+    }
+    bench_stop(&b, (uint64_t)cycles * SMALL_FILES, (uint64_t)cycles * SMALL_FILES * SMALL_SIZE);
+
+    bench_start(&b, "lookup");
+    for (int n = 0; n < LOOKUPS; n++) {
+        small_path(path, n % SMALL_FILES);
+        if (!fat_exists(path)) return -1;
+    }
+    bench_stop(&b, LOOKUPS, 0);
+
+    bench_start(&b, "rm");
+    for (int i = 0; i < SMALL_FILES; i++) {
+        small_path(path, i);
+        if (fat_rm(path) < 0) return -1;
+    }
+    bench_stop(&b, SMALL_FILES, 0);
+
+    return fat_rm("/HBENCH");
+}
+
+static int bench_big_file(void) {
+    bench_t b;
+
+    for (int i = 0; i < BIG_CHUNK; i++) big_chunk[i] = (uint8_t)(i * 13);
+
+    bench_start(&b, "seq_write");
+    int fd = fat_open("/HBIG.DAT", FAT_O_WRITE | FAT_O_CREATE | FAT_O_TRUNC);
+    if (fd < 0) return -1;
+    for (int done = 0; done < BIG_SIZE; done += BIG_CHUNK) {
+        if (fat_fwrite(fd, big_chunk, BIG_CHUNK) != BIG_CHUNK) return -1;
+    }
+    if (fat_close(fd) < 0) return -1;
+    bench_stop(&b, BIG_SIZE / BIG_CHUNK, BIG_SIZE);
+
+    bench_start(&b, "seq_read");
+    fd = fat_open("/HBIG.DAT", FAT_O_READ);
+    if (fd < 0) return -1;
+    for (int done = 0; done < BIG_SIZE; done += 512) {
+        if (fat_fread(fd, big_chunk, 512) != 512) return -1;
+    }
+    fat_close(fd);
+    bench_stop(&b, BIG_SIZE / 512, BIG_SIZE);
+
+    return fat_rm("/HBIG.DAT");
+}
+
+static int bench_memfs(int cycles) {
+    bench_t b;
+    char path[64];
+    uint64_t ops = 0;
+
+    hosted_set_quiet(1);
+    bench_start(&b, "memfs_create_rm");
+    for (int c = 0; c < cycles; c++) {
+        fs_init();
+        for (int d = 0; d < MEMFS_DIRS; d++) {
+            snprintf(path, sizeof(path), "/home/d%d", d);
+            if (fs_mkdir(path) < 0) return -1;
+            for (int i = 0; i < MEMFS_FILES; i++) {
+                snprintf(path, sizeof(path), "/home/d%d/f%d", d, i);
+                if (fs_touch(path) < 0 || fs_write(path, "hosted") < 0) return -1;
+                ops += 2;
+            }
+        }
+        for (int d = 0; d < MEMFS_DIRS; d++) {
+            for (int i = 0; i < MEMFS_FILES; i++) {
+                snprintf(path, sizeof(path), "/home/d%d/f%d", d, i);
+                if (fs_rm(path) < 0) return -1;
+                ops++;
+            }
+        }
+    }
+    bench_stop(&b, ops, 0);
+
+    bench_start(&b, "memfs_lookup");
+    fs_init();
+    fs_mkdir("/home/a");
+    fs_mkdir("/home/a/b");
+    fs_touch("/home/a/b/file");
+    for (int n = 0; n < LOOKUPS; n++) {
+        if (!resolve_path("/home/a/b/file", fs_root)) return -1;
+    }
+    bench_stop(&b, LOOKUPS, 0);
+    hosted_set_quiet(0);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <image> [cycles]\n", argv[0]);
+        return 2;
+    }
+    int cycles = argc > 2 ? atoi(argv[2]) : 10;
+    if (cycles <= 0) cycles = 1;
+
+    if (hosted_attach(BENCH_DRIVE, argv[1]) < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    bench_t b;
+    bench_start(&b, "mount");
+    if (fat_mount(BENCH_DRIVE) < 0) return 1;
+    bench_stop(&b, 1, 0);
+
+    int rc = 0;
+    if (bench_small_files(cycles) < 0 || bench_big_file() < 0 || bench_memfs(cycles) < 0) {
+        fprintf(stderr, "fatbench: operation failed\n");
+        rc = 1;
+    }
+
+    fat_unmount();
+    hosted_detach_all();
+    return rc;
+}
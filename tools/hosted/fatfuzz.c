@@ -0,0 +1,228 @@
+/*
+ * fatfuzz: random create/write/append/read/delete sequences checked
+ * against an in-memory model of every file.
+ *
+ *   fatfuzz <image> [seed] [ops]
+ *
+ * The volume is remounted and the cache resized now and then, so dirty
+ * metadata has to survive write-back and eviction. At the end every file
+ * is deleted and the free space must match what it was at the start.
+ * Files are also opened twice at once: a second writer must be refused,
+ * since each handle keeps its own size and cluster chain.
+ * A failure prints the seed and the operation number to replay it.
+ */
+#include "hosted.h"
+#include "../../src/kernel/fs/fat/fat.h"
+#include "../../src/kernel/fs/bcache/bcache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FUZZ_DRIVE      1
+#define FUZZ_FILES      24
+#define FUZZ_MAX_SIZE   (16 * 1024)
+
+typedef struct {
+    char        path[64];
+    int         exists;
+    uint32_t    size;
+    uint8_t     data[FUZZ_MAX_SIZE];
+} model_file_t;
+
+static model_file_t model[FUZZ_FILES];
+static uint8_t scratch[FUZZ_MAX_SIZE];
+static uint8_t readback[FUZZ_MAX_SIZE];
+
+static uint64_t rng_state;
+static unsigned long seed;
+static long op_index;
+
+static uint32_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 16);
+}
+
+static uint32_t rng_below(uint32_t n) {
+    return n ? rng() % n : 0;
+}
+
+static void fail(const char* what, const model_file_t* f) {
+    fprintf(stderr, "fatfuzz: %s on %s (seed=%lu op=%ld)\n", what, f ? f->path : "-", seed, op_index);
+    exit(1);
+}
+
+static void fill(uint8_t* buf, uint32_t size) {
+    uint32_t pattern = rng();
+    for (uint32_t i = 0; i < size; i++) buf[i] = (uint8_t)(pattern + i * 31);
+}
+
+static void verify(model_file_t* f) {
+    if (!f->exists) {
+        if (fat_exists(f->path)) fail("deleted file still exists", f);
+        return;
+    }
+
+    fat_file_info_t info;
+    if (fat_stat(f->path, &info) < 0) fail("stat failed", f);
+    if (info.size != f->size) fail("size mismatch", f);
+
+    int got = fat_read(f->path, readback, FUZZ_MAX_SIZE);
+    if (got != (int)f->size) fail("short read", f);
+    if (memcmp(readback, f->data, f->size) != 0) fail("content mismatch", f);
+}
+
+static void op_write(model_file_t* f) {
+    uint32_t size = rng_below(FUZZ_MAX_SIZE + 1);
+    fill(scratch, size);
+    if (fat_write(f->path, scratch, size) < 0) fail("write failed", f);
+
+    memcpy(f->data, scratch, size);
+    f->size = size;
+    f->exists = 1;
+}
+
+static void op_append(model_file_t* f) {
+    uint32_t size = rng_below(FUZZ_MAX_SIZE - f->size + 1);
+    fill(scratch, size);
+    if (fat_append(f->path, scratch, size) < 0) fail("append failed", f);
+
+    memcpy(f->data + f->size, scratch, size);
+    f->size += size;
+}
+
+/* Overwrite (and possibly extend) a range through a handle */
+static void op_pwrite(model_file_t* f) {
+    uint32_t offset = rng_below(f->size + 1);
+    uint32_t size = rng_below(FUZZ_MAX_SIZE - offset + 1);
+    fill(scratch, size);
+
+    int fd = fat_open(f->path, FAT_O_WRITE);
+    if (fd < 0) fail("open for write failed", f);
+    if (fat_pwrite(fd, scratch, size, offset) != (int)size) fail("pwrite failed", f);
+    if (fat_close(fd) < 0) fail("close failed", f);
+
+    memcpy(f->data + offset, scratch, size);
+    if (offset + size > f->size) f->size = offset + size;
+}
+
+static void op_pread(model_file_t* f) {
+    uint32_t offset = rng_below(f->size + 1);
+    uint32_t size = rng_below(f->size - offset + 1);
+
+    int fd = fat_open(f->path, FAT_O_READ);
+    if (fd < 0) fail("open for read failed", f);
+    if (fat_pread(fd, readback, size, offset) != (int)size) fail("pread failed", f);
+    fat_close(fd);
+
+    if (memcmp(readback, f->data + offset, size) != 0) fail("pread mismatch", f);
+}
+
+/* Extend a file through one handle while a second open, rm and append are tried */
+static void op_shared(model_file_t* f) {
+    uint32_t size = rng_below(FUZZ_MAX_SIZE - f->size + 1);
+    fill(scratch, size);
+
+    int fd = fat_open(f->path, FAT_O_WRITE);
+    if (fd < 0) fail("open for write failed", f);
+    if (fat_open(f->path, FAT_O_WRITE) >= 0) fail("second writer opened", f);
+    if (fat_open(f->path, FAT_O_WRITE | FAT_O_TRUNC) >= 0) fail("truncate under a handle", f);
+    if (fat_append(f->path, scratch, 1) >= 0) fail("append under a handle", f);
+    if (fat_rm(f->path) >= 0) fail("rm under a handle", f);
+
+    int reader = fat_open(f->path, FAT_O_READ);
+    if (reader < 0) fail("open for read next to a writer failed", f);
+
+    if (fat_pwrite(fd, scratch, size, f->size) != (int)size) fail("pwrite failed", f);
+    if (fat_pread(reader, readback, f->size, 0) != (int)f->size) fail("pread failed", f);
+    if (memcmp(readback, f->data, f->size) != 0) fail("pread mismatch", f);
+    fat_close(reader);
+    if (fat_close(fd) < 0) fail("close failed", f);
+
+    memcpy(f->data + f->size, scratch, size);
+    f->size += size;
+}
+
+static void op_rm(model_file_t* f) {
+    if (fat_rm(f->path) < 0) fail("rm failed", f);
+    f->exists = 0;
+    f->size = 0;
+}
+
+static void remount(void) {
+    fat_unmount();
+    if (fat_mount(FUZZ_DRIVE) < 0) fail("remount failed", NULL);
+    for (int i = 0; i < FUZZ_FILES; i++) verify(&model[i]);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <image> [seed] [ops]\n", argv[0]);
+        return 2;
+    }
+    seed = argc > 2 ? strtoul(argv[2], NULL, 0) : 1;
+    long ops = argc > 3 ? atol(argv[3]) : 5000;
+    rng_state = seed * 0x9E3779B97F4A7C15ull + 1;
+
+    if (hosted_attach(FUZZ_DRIVE, argv[1]) < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    hosted_set_quiet(1);
+    if (fat_mount(FUZZ_DRIVE) < 0) fail("mount failed", NULL);
+
+    /* Short names in the root, long names (LFN entries) in a subdirectory */
+    for (int i = 0; i < FUZZ_FILES; i++) {
+        if (i % 2) snprintf(model[i].path, sizeof(model[i].path), "/FUZZ/long file name %d.data", i);
+        else snprintf(model[i].path, sizeof(model[i].path), "/FZ%d.BIN", i);
+        if (fat_exists(model[i].path) && fat_rm(model[i].path) < 0) fail("cleanup failed", &model[i]);
+    }
+    if (fat_is_dir("/FUZZ") && fat_rm("/FUZZ") < 0) fail("cleanup failed", NULL);
+
+    /* Directories never shrink, so the baseline is taken without /FUZZ */
+    bcache_sync(BCACHE_ALL_DRIVES);
+    uint32_t free_before = fat_free_space();
+    if (fat_mkdir("/FUZZ") < 0) fail("mkdir failed", NULL);
+
+    for (op_index = 0; op_index < ops; op_index++) {
+        model_file_t* f = &model[rng_below(FUZZ_FILES)];
+        uint32_t kind = rng_below(100);
+
+        if (kind < 2) {
+            remount();
+        } else if (kind < 4) {
+            bcache_set_size(8 + rng_below(BCACHE_MAX_BLOCKS - 8));
+        } else if (!f->exists || kind < 25) {
+            op_write(f);
+        } else if (kind < 40) {
+            op_append(f);
+        } else if (kind < 50) {
+            op_pwrite(f);
+        } else if (kind < 55) {
+            op_shared(f);
+        } else if (kind < 70) {
+            op_pread(f);
+        } else if (kind < 85) {
+            verify(f);
+        } else {
+            op_rm(f);
+        }
+    }
+
+    remount();
+    for (int i = 0; i < FUZZ_FILES; i++) {
+        if (model[i].exists) op_rm(&model[i]);
+    }
+    if (fat_rm("/FUZZ") < 0) fail("rmdir failed", NULL);
+    remount();
+
+    if (fat_free_space() != free_before) fail("free space leaked", NULL);
+    fat_unmount();
+    hosted_detach_all();
+
+    printf("fatfuzz seed=%lu ops=%ld ok\n", seed, ops);
+    return 0;
+}
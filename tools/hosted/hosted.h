@@ -0,0 +1,32 @@
+#ifndef HOSTED_H
+#define HOSTED_H
+
+#include <stdint.h>
+
+/*
+ * Linux userspace shim for the filesystem code. ATA drives are raw image
+ * files (as made by create_disks.sh), VGA output goes to stdout.
+ */
+
+typedef struct {
+    uint64_t    read_cmds;
+    uint64_t    write_cmds;
+    uint64_t    read_sectors;
+    uint64_t    write_sectors;
+    uint64_t    flushes;
+} hosted_io_stats_t;
+
+/* Back ATA drive 0..3 with an image file; call before the first mount */
+int hosted_attach(uint8_t drive, const char* path);
+void hosted_detach_all(void);
+
+/* Silence console output from the kernel code (errors included) */
+void hosted_set_quiet(int quiet);
+
+void hosted_get_io(hosted_io_stats_t* out);
+void hosted_reset_io(void);
+
+/* Monotonic clock in microseconds */
+uint64_t hosted_now_us(void);
+
+#endif
@@ -0,0 +1,193 @@
+#include "hosted.h"
+#include "../../src/kernel/drivers/ata/ata.h"
+#include "../../src/kernel/mm/pmm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static FILE* hosted_images[4];
+static ata_device_t hosted_devices[4];
+static hosted_io_stats_t hosted_io;
+static int hosted_quiet = 0;
+
+int hosted_attach(uint8_t drive, const char* path) {
+    if (drive >= 4) return -1;
+
+    FILE* f = fopen(path, "r+b");
+    if (!f) return -1;
+
+    struct stat st;
+    if (fstat(fileno(f), &st) < 0) {
+        fclose(f);
+        return -1;
+    }
+
+    if (hosted_images[drive]) fclose(hosted_images[drive]);
+    hosted_images[drive] = f;
+
+    ata_device_t* dev = &hosted_devices[drive];
+    memset(dev, 0, sizeof(*dev));
+    dev->present = 1;
+    dev->channel = drive / 2;
+    dev->drive = drive % 2;
+    dev->lba48 = 1;
+    dev->size = (uint32_t)(st.st_size / ATA_SECTOR_SIZE);
+    snprintf(dev->model, sizeof(dev->model), "%s", path);
+    return 0;
+}
+
+void hosted_detach_all(void) {
+    for (int i = 0; i < 4; i++) {
+        if (hosted_images[i]) fclose(hosted_images[i]);
+        hosted_images[i] = NULL;
+        hosted_devices[i].present = 0;
+    }
+}
+
+void hosted_set_quiet(int quiet) {
+    hosted_quiet = quiet;
+}
+
+void hosted_get_io(hosted_io_stats_t* out) {
+    *out = hosted_io;
+}
+
+void hosted_reset_io(void) {
+    memset(&hosted_io, 0, sizeof(hosted_io));
+}
+
+uint64_t hosted_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+/* ATA: every command is a pread/pwrite on the image */
+
+int ata_init(void) {
+    int found = 0;
+    for (int i = 0; i < 4; i++) {
+        if (hosted_images[i]) found++;
+    }
+    return found;
+}
+
+int ata_drive_detected(uint8_t drive) {
+    return drive < 4 && hosted_images[drive] != NULL;
+}
+
+int ata_drive_exists(uint8_t drive) {
+    return ata_drive_detected(drive);
+}
+
+ata_device_t* ata_get_device(uint8_t drive) {
+    return ata_drive_detected(drive) ? &hosted_devices[drive] : NULL;
+}
+
+int ata_read_sectors(uint8_t drive, uint32_t lba, uint16_t count, void* buffer) {
+    if (!ata_drive_detected(drive) || count == 0) return -1;
+
+    size_t bytes = (size_t)count * ATA_SECTOR_SIZE;
+    if (pread(fileno(hosted_images[drive]), buffer, bytes, (off_t)lba * ATA_SECTOR_SIZE) != (ssize_t)bytes) {
+        return -1;
+    }
+    hosted_io.read_cmds++;
+    hosted_io.read_sectors += count;
+    return 0;
+}
+
+int ata_write_sectors(uint8_t drive, uint32_t lba, uint16_t count, const void* buffer) {
+    if (!ata_drive_detected(drive) || count == 0) return -1;
+
+    size_t bytes = (size_t)count * ATA_SECTOR_SIZE;
+    if (pwrite(fileno(hosted_images[drive]), buffer, bytes, (off_t)lba * ATA_SECTOR_SIZE) != (ssize_t)bytes) {
+        return -1;
+    }
+    hosted_io.write_cmds++;
+    hosted_io.write_sectors += count;
+    return 0;
+}
+
+int ata_flush(uint8_t drive) {
+    if (!ata_drive_detected(drive)) return -1;
+    hosted_io.flushes++;
+    return 0;
+}
+
+/* No real channels: a started transfer has already finished */
+static int hosted_async_status[4];
+
+int ata_start_transfer(uint8_t drive, uint32_t lba, uint16_t count, void* buffer, int write) {
+    if (!ata_drive_detected(drive)) return -1;
+    hosted_async_status[drive] = write ? ata_write_sectors(drive, lba, count, buffer)
+                                       : ata_read_sectors(drive, lba, count, buffer);
+    return 0;
+}
+
+int ata_finish_transfer(uint8_t drive) {
+    if (!ata_drive_detected(drive)) return -1;
+    return hosted_async_status[drive];
+}
+
+/* Other block backends do not exist here */
+int virtio_blk_init(void) { return 0; }
+int ahci_init(void) { return 0; }
+
+/*
+ * Page allocator on top of aligned_alloc. Each block is preceded by one
+ * page that records its order and owner, so kmalloc.c runs unchanged.
+ */
+
+static pmm_stats_t hosted_pmm;
+
+void* pmm_alloc_pages(uint32_t order, pmm_owner_t owner) {
+    if (order > PMM_MAX_ORDER) return NULL;
+
+    uint8_t* base = aligned_alloc(PMM_PAGE_SIZE, (size_t)(PMM_PAGE_SIZE << order) + PMM_PAGE_SIZE);
+    if (!base) return NULL;
+
+    base[0] = (uint8_t)order;
+    base[1] = (uint8_t)owner;
+    hosted_pmm.owner_pages[owner] += 1u << order;
+    return base + PMM_PAGE_SIZE;
+}
+
+void pmm_free_pages(void* addr) {
+    uint8_t* base = (uint8_t*)addr - PMM_PAGE_SIZE;
+    hosted_pmm.owner_pages[base[1]] -= 1u << base[0];
+    free(base);
+}
+
+uint32_t pmm_order_for_size(uint32_t size) {
+    uint32_t order = 0;
+    while (order <= PMM_MAX_ORDER && ((uint32_t)PMM_PAGE_SIZE << order) < size) order++;
+    return order;
+}
+
+void pmm_get_stats(pmm_stats_t* stats) {
+    *stats = hosted_pmm;
+}
+
+/* Console */
+
+void vga_putc(char c) {
+    if (!hosted_quiet) putchar(c);
+}
+
+void vga_print(const char* str) {
+    if (!hosted_quiet) fputs(str, stdout);
+}
+
+void vga_print_color(const char* str, uint8_t color) {
+    (void)color;
+    if (!hosted_quiet) fputs(str, stdout);
+}
+
+void panic(const char* module, const char* reason, const char* func_name) {
+    fprintf(stderr, "PANIC [%s] %s (in %s)\n", module, reason, func_name);
+    abort();
+}